@@ -0,0 +1,45 @@
+#include "ooo_cpu.h"
+#include "checkpoint.h"
+
+#define BIMODAL_TABLE_SIZE 16384
+#define BIMODAL_PRIME 16381
+#define MAX_COUNTER 3
+
+class BIMODAL : public BRANCH_PREDICTOR {
+  public:
+    int bimodal_table[BIMODAL_TABLE_SIZE];
+
+    void initialize();
+    uint8_t predict_branch(uint64_t ip);
+    void last_branch_result(uint64_t ip, uint8_t taken);
+};
+
+REGISTER_BRANCH_PREDICTOR("bimodal", BIMODAL);
+
+void BIMODAL::initialize()
+{
+    cout << "CPU " << cpu << " Bimodal branch predictor" << endl;
+
+    for(int i = 0; i < BIMODAL_TABLE_SIZE; i++)
+        bimodal_table[i] = 0;
+
+    checkpoint.add_section(section_name("bimodal_table"), bimodal_table, sizeof(bimodal_table));
+}
+
+uint8_t BIMODAL::predict_branch(uint64_t ip)
+{
+    uint32_t hash = ip % BIMODAL_PRIME;
+    uint8_t prediction = (bimodal_table[hash] >= ((MAX_COUNTER + 1)/2)) ? 1 : 0;
+
+    return prediction;
+}
+
+void BIMODAL::last_branch_result(uint64_t ip, uint8_t taken)
+{
+    uint32_t hash = ip % BIMODAL_PRIME;
+
+    if (taken && (bimodal_table[hash] < MAX_COUNTER))
+        bimodal_table[hash]++;
+    else if ((taken == 0) && (bimodal_table[hash] > 0))
+        bimodal_table[hash]--;
+}
@@ -53,6 +53,7 @@ sources for you to plagiarize.
 #include <stdlib.h>
 
 #include "ooo_cpu.h"
+#include "checkpoint.h"
 
 // this many tables
 
@@ -83,29 +84,35 @@ int history_lengths[NTABLES] = { 0, 3, 4, 6, 8, 10, 14, 19, 26, 36, 49, 67, 91,
 
 #define NGHIST_WORDS	(MAXHIST/LOG_TABLE_SIZE+1)
 
-// tables of 8-bit weights
+class HASHED_PERCEPTRON : public BRANCH_PREDICTOR {
+  public:
+    // tables of 8-bit weights
+    int tables[NTABLES][TABLE_SIZE];
 
-int tables[NUM_CPUS][NTABLES][TABLE_SIZE];
+    // words that store the global history
+    unsigned int ghist_words[NGHIST_WORDS];
 
-// words that store the global history
+    // remember the indices into the tables from prediction to update
+    unsigned int indices[NTABLES];
 
-unsigned int ghist_words[NUM_CPUS][NGHIST_WORDS];
+    // initialize theta to something reasonable, 
+    int 
+        theta, 
 
-// remember the indices into the tables from prediction to update
+    // initialize counter for threshold setting algorithm
+        tc, 	
 
-unsigned int indices[NUM_CPUS][NTABLES];
+    // perceptron sum
+        yout;
 
-// initialize theta to something reasonable, 
-int 
-	theta[NUM_CPUS], 
+    void initialize();
+    uint8_t predict_branch(uint64_t ip);
+    void last_branch_result(uint64_t ip, uint8_t taken);
+};
 
-// initialize counter for threshold setting algorithm
-	tc[NUM_CPUS], 	
+REGISTER_BRANCH_PREDICTOR("hashed_perceptron", HASHED_PERCEPTRON);
 
-// perceptron sum
-	yout[NUM_CPUS];
-
-void O3_CPU::initialize_branch_predictor () {
+void HASHED_PERCEPTRON::initialize () {
 	// zero out the weights tables
 
 	memset (tables, 0, sizeof (tables));
@@ -116,14 +123,21 @@ void O3_CPU::initialize_branch_predictor () {
 
 	// make a reasonable theta
 
-	for (int i=0; i<NUM_CPUS; i++) theta[i] = 10;
+	theta = 10;
+
+	// save the weights, history and threshold state
+
+	checkpoint.add_section(section_name("hashed_perceptron.tables"), tables, sizeof(tables));
+	checkpoint.add_section(section_name("hashed_perceptron.ghist_words"), ghist_words, sizeof(ghist_words));
+	checkpoint.add_section(section_name("hashed_perceptron.theta"), &theta, sizeof(theta));
+	checkpoint.add_section(section_name("hashed_perceptron.tc"), &tc, sizeof(tc));
 }
 
-uint8_t O3_CPU::predict_branch(uint64_t pc) {
+uint8_t HASHED_PERCEPTRON::predict_branch(uint64_t pc) {
 
 	// initialize perceptron sum
 
-	yout[cpu] = 0;
+	yout = 0;
 
 	// for each table...
 
@@ -148,11 +162,11 @@ uint8_t O3_CPU::predict_branch(uint64_t pc) {
 		// XOR up to the next-to-the-last word
 
 		int j;
-		for (j=0; j<most_words; j++) x ^= ghist_words[cpu][j];
+		for (j=0; j<most_words; j++) x ^= ghist_words[j];
 
 		// XOR in the last word
 
-		x ^= ghist_words[cpu][j] & ((1<<last_word)-1);
+		x ^= ghist_words[j] & ((1<<last_word)-1);
 
 		// XOR in the PC to spread accesses around (like gshare)
 
@@ -164,20 +178,20 @@ uint8_t O3_CPU::predict_branch(uint64_t pc) {
 
 		// remember this index for update
 
-		indices[cpu][i] = x;
+		indices[i] = x;
 
 		// add the selected weight to the perceptron sum
 
-		yout[cpu] += tables[cpu][i][x];
+		yout += tables[i][x];
 	}
-	return yout[cpu] >= 1;
+	return yout >= 1;
 }
 
-void O3_CPU::last_branch_result(uint64_t pc, uint8_t taken) {
+void HASHED_PERCEPTRON::last_branch_result(uint64_t pc, uint8_t taken) {
 
 	// was this prediction correct?
 
-	bool correct = taken == (yout[cpu] >= 1);
+	bool correct = taken == (yout >= 1);
 
 	// insert this branch outcome into the global history
 
@@ -186,27 +200,27 @@ void O3_CPU::last_branch_result(uint64_t pc, uint8_t taken) {
 
 		// shift b into the lsb of the current word
 
-		ghist_words[cpu][i] <<= 1;
-		ghist_words[cpu][i] |= b;
+		ghist_words[i] <<= 1;
+		ghist_words[i] |= b;
 
 		// get b as the previous msb of the current word
 
-		b = !!(ghist_words[cpu][i] & TABLE_SIZE);
-		ghist_words[cpu][i] &= TABLE_SIZE-1;
+		b = !!(ghist_words[i] & TABLE_SIZE);
+		ghist_words[i] &= TABLE_SIZE-1;
 	}
 
 	// get the magnitude of yout
 
-	int a = (yout[cpu] < 0) ? -yout[cpu] : yout[cpu];
+	int a = (yout < 0) ? -yout : yout;
 
 	// perceptron learning rule: train if misprediction or weak correct prediction
 
-	if (!correct || a < theta[cpu]) {
+	if (!correct || a < theta) {
 		// update weights
 		for (int i=0; i<NTABLES; i++) {
 			// which weight did we use to compute yout?
 
-			int *c = &tables[cpu][i][indices[cpu][i]];
+			int *c = &tables[i][indices[i]];
 
 			// increment if taken, decrement if not, saturating at 127/-128
 
@@ -223,19 +237,19 @@ void O3_CPU::last_branch_result(uint64_t pc, uint8_t taken) {
 
 			// increase theta after enough mispredictions
 
-			tc[cpu]++;
-			if (tc[cpu] >= SPEED) {
-				theta[cpu]++;
-				tc[cpu] = 0;
+			tc++;
+			if (tc >= SPEED) {
+				theta++;
+				tc = 0;
 			}
-		} else if (a < theta[cpu]) {
+		} else if (a < theta) {
 
 			// decrease theta after enough weak but correct predictions
 
-			tc[cpu]--;
-			if (tc[cpu] <= -SPEED) {
-				theta[cpu]--;
-				tc[cpu] = 0;
+			tc--;
+			if (tc <= -SPEED) {
+				theta--;
+				tc = 0;
 			}
 		}
 	}
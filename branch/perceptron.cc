@@ -56,6 +56,7 @@
  */
 
 #include "ooo_cpu.h"
+#include "checkpoint.h"
 
 /* history length for the global history shift register */
 
@@ -124,50 +125,63 @@ typedef struct {
 		*perc;
 } perceptron_state;
 
-perceptron 
-	/* table of perceptrons */
+class PERCEPTRON : public BRANCH_PREDICTOR {
+  public:
+    perceptron 
+    	/* table of perceptrons */
+
+    	perceptrons[NUM_PERCEPTRONS];
 
-	perceptrons[NUM_CPUS][NUM_PERCEPTRONS];
+    perceptron_state 
+    	/* state for updating perceptron predictor */
 
-perceptron_state 
-	/* state for updating perceptron predictor */
+    	perceptron_state_buf[NUM_UPDATE_ENTRIES];
 
-	perceptron_state_buf[NUM_CPUS][NUM_UPDATE_ENTRIES];
+    int 
+    	/* index of the next "free" perceptron_state */
 
-int 
-	/* index of the next "free" perceptron_state */
+    	perceptron_state_buf_ctr;
 
-	perceptron_state_buf_ctr[NUM_CPUS];
+    unsigned long long int
 
-unsigned long long int
+    	/* speculative global history - updated by predictor */
 
-	/* speculative global history - updated by predictor */
+    	spec_global_history,
 
-	spec_global_history[NUM_CPUS],
+    	/* real global history - updated when the predictor is updated */
 
-	/* real global history - updated when the predictor is updated */
+    	global_history;
 
-	global_history[NUM_CPUS];
+    perceptron_state *u;
 
-perceptron_state *u[NUM_CPUS];
+    void initialize();
+    uint8_t predict_branch(uint64_t ip);
+    void last_branch_result(uint64_t ip, uint8_t taken);
+};
+
+REGISTER_BRANCH_PREDICTOR("perceptron", PERCEPTRON);
 
 /* initialize a single perceptron */
-void initialize_perceptron (perceptron *p) {
+static void initialize_perceptron (perceptron *p) {
     int	i;
 
     for (i=0; i<=PERCEPTRON_HISTORY; i++) p->weights[i] = 0;
 }
 
-void O3_CPU::initialize_branch_predictor()
+void PERCEPTRON::initialize()
 {
-    spec_global_history[cpu] = 0;
-    global_history[cpu] = 0;
-    perceptron_state_buf_ctr[cpu] = 0;
+    spec_global_history = 0;
+    global_history = 0;
+    perceptron_state_buf_ctr = 0;
     for (int i=0; i<NUM_PERCEPTRONS; i++)
-        initialize_perceptron (&perceptrons[cpu][i]);
+        initialize_perceptron (&perceptrons[i]);
+
+    checkpoint.add_section(section_name("perceptron.perceptrons"), perceptrons, sizeof(perceptrons));
+    checkpoint.add_section(section_name("perceptron.spec_global_history"), &spec_global_history, sizeof(spec_global_history));
+    checkpoint.add_section(section_name("perceptron.global_history"), &global_history, sizeof(global_history));
 }
 
-uint8_t O3_CPU::predict_branch(uint64_t ip)
+uint8_t PERCEPTRON::predict_branch(uint64_t ip)
 {
     uint64_t address = ip;
 
@@ -185,9 +199,9 @@ uint8_t O3_CPU::predict_branch(uint64_t ip)
      * bumping up the pointer (and possibly letting it wrap around) 
      */
 
-    u[cpu] = &perceptron_state_buf[cpu][perceptron_state_buf_ctr[cpu]++];
-    if (perceptron_state_buf_ctr[cpu] >= NUM_UPDATE_ENTRIES)
-        perceptron_state_buf_ctr[cpu] = 0;
+    u = &perceptron_state_buf[perceptron_state_buf_ctr++];
+    if (perceptron_state_buf_ctr >= NUM_UPDATE_ENTRIES)
+        perceptron_state_buf_ctr = 0;
 
     /* hash the address to get an index into the table of perceptrons */
 
@@ -195,7 +209,7 @@ uint8_t O3_CPU::predict_branch(uint64_t ip)
 
     /* get pointers to that perceptron and its weights */
 
-    p = &perceptrons[cpu][index];
+    p = &perceptrons[index];
     w = &p->weights[0];
 
     /* initialize the output to the bias weight, and bump the pointer
@@ -213,7 +227,7 @@ uint8_t O3_CPU::predict_branch(uint64_t ip)
      * register
      */
     for (mask=1,i=0; i<PERCEPTRON_HISTORY; i++,mask<<=1,w++) {
-        if (spec_global_history[cpu] & mask)
+        if (spec_global_history & mask)
             output += *w;
         else
             output += -*w;
@@ -221,20 +235,20 @@ uint8_t O3_CPU::predict_branch(uint64_t ip)
 
     /* record the various values needed to update the predictor */
 
-    u[cpu]->output = output;
-    u[cpu]->perc = p;
-    u[cpu]->history = spec_global_history[cpu];
-    u[cpu]->prediction = output >= 0;
-    u[cpu]->dummy_counter = u[cpu]->prediction ? 3 : 0;
+    u->output = output;
+    u->perc = p;
+    u->history = spec_global_history;
+    u->prediction = output >= 0;
+    u->dummy_counter = u->prediction ? 3 : 0;
 
     /* update the speculative global history register */
 
-    spec_global_history[cpu] <<= 1;
-    spec_global_history[cpu] |= u[cpu]->prediction;
-    return u[cpu]->prediction;
+    spec_global_history <<= 1;
+    spec_global_history |= u->prediction;
+    return u->prediction;
 }
 
-void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
+void PERCEPTRON::last_branch_result(uint64_t ip, uint8_t taken)
 {
     int	
         i,
@@ -247,23 +261,23 @@ void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
 
     /* update the real global history shift register */
 
-    global_history[cpu] <<= 1;
-    global_history[cpu] |= taken;
+    global_history <<= 1;
+    global_history |= taken;
 
     /* if this branch was mispredicted, restore the speculative
      * history to the last known real history
      */
 
-    if (u[cpu]->prediction != taken) spec_global_history[cpu] = global_history[cpu];
+    if (u->prediction != taken) spec_global_history = global_history;
 
     /* if the output of the perceptron predictor is outside of
      * the range [-THETA,THETA] *and* the prediction was correct,
      * then we don't need to adjust the weights
      */
 
-    if (u[cpu]->output > THETA)
+    if (u->output > THETA)
         y = 1;
-    else if (u[cpu]->output < -THETA)
+    else if (u->output < -THETA)
         y = 0;
     else
         y = 2;
@@ -272,7 +286,7 @@ void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
 
     /* w is a pointer to the first weight (the bias weight) */
 
-    w = &u[cpu]->perc->weights[0];
+    w = &u->perc->weights[0];
 
     /* if the branch was taken, increment the bias weight,
      * else decrement it, with saturating arithmetic
@@ -291,7 +305,7 @@ void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
 
     /* get the history that led to this prediction */
 
-    history = u[cpu]->history;
+    history = u->history;
 
     /* for each weight and corresponding bit in the history register... */
 
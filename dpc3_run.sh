@@ -39,13 +39,13 @@ REPL="lru"                                                 # Cache Replacement P
 CORES="1"                                                  # Number of Cores
 WARMUP_INSTR="50000000"                                    # Warmup Instructions
 SIM_INSTR="200000000"                                      # Simulation Instructions
-BINARY="${CHAMPSIM_DIR}/bin/${BP}-${L1D_PREF}-${L2C_PREF}-${LLC_PREF}-${REPL}-${CORES}core"
+BINARY="${CHAMPSIM_DIR}/bin/champsim-${CORES}core"
 
 # Step 3: Build Configuration
-( ${BUILD_SCRIPT} ${BP} ${L1D_PREF} ${L2C_PREF} ${LLC_PREF} ${REPL} ${CORES} > /dev/null )
+( cd ${CHAMPSIM_DIR} && ${BUILD_SCRIPT} ${CORES} > /dev/null )
 #exit
 # Step 4: Run Configuration on Traces
 for trace in ${TRACES}
 do
-  ( ${BINARY} -warmup_instructions ${WARMUP_INSTR} -simulation_instructions ${SIM_INSTR} -traces ${TRACE_DIR}/${trace} > "${RESULT_DIR}/${L1D_PREF}-${L2C_PREF}-${LLC_PREF}-${trace}.txt" & )
+  ( ${BINARY} -branch ${BP} -l1d_pref ${L1D_PREF} -l2c_pref ${L2C_PREF} -llc_pref ${LLC_PREF} -llc_repl ${REPL} -warmup_instructions ${WARMUP_INSTR} -simulation_instructions ${SIM_INSTR} -traces ${TRACE_DIR}/${trace} > "${RESULT_DIR}/${L1D_PREF}-${L2C_PREF}-${LLC_PREF}-${trace}.txt" & )
 done
@@ -1,4 +0,0 @@
-#!/bin/bash
-
-cp prefetcher/problem1.l1d_pref.cc prefetcher/problem1.l1d_pref
-cp prefetcher/problem2.l1d_pref.cc prefetcher/problem2.l1d_pref
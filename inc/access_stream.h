@@ -0,0 +1,108 @@
+#ifndef ACCESS_STREAM_H
+#define ACCESS_STREAM_H
+
+#include "champsim.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+// ACCESS STREAM
+// -record_stream L1D|L2C|LLC|DRAM writes every access that level serves to a file: the caches record the reads,
+// prefetches and writebacks as handle_read/handle_prefetch/handle_writeback count them, the DRAM the requests its
+// channels return (hit is a row buffer hit there). the file is a header and then blocks of records, each block
+// byte-shuffled (byte i of every record, then byte i+1, ...) and compressed with zlib on a writer thread
+#define ACCESS_STREAM_MAGIC "CHAMPSTR"
+#define ACCESS_STREAM_VERSION 1
+#define ACCESS_STREAM_BLOCK_RECORDS 65536
+
+// blocks waiting for the writer thread before the simulation waits for it
+#define ACCESS_STREAM_BLOCKS 8
+
+class ACCESS_STREAM_HEADER {
+  public:
+    char magic[8];
+    uint32_t version, record_size;
+    char level[8];
+};
+
+class ACCESS_STREAM_BLOCK_HEADER {
+  public:
+    uint32_t num_records, compressed_size;
+};
+
+class ACCESS_RECORD {
+  public:
+    uint64_t cycle, instr, ip, full_addr; // instr: instructions the cpu had retired
+    uint32_t cpu;
+    uint8_t type, hit,
+            pf_origin_level, // level whose prefetcher asked for a PREFETCH, 0 for the other types
+            fill_level;
+};
+
+class PACKET;
+
+// ACCESS STREAM WRITER
+// owns the file and the thread that compresses and writes the blocks
+class ACCESS_STREAM_WRITER {
+  public:
+    string filename, level;
+    uint64_t num_records, num_bytes;
+
+    ACCESS_STREAM_WRITER(string name, string level_name);
+    ~ACCESS_STREAM_WRITER();
+
+    // takes the records of block and leaves it empty; waits while the writer is ACCESS_STREAM_BLOCKS blocks behind
+    void submit(vector <ACCESS_RECORD> &block);
+
+    // writes what was submitted and closes the file
+    void close();
+
+  private:
+    FILE *file;
+    thread writer;
+    mutex lock;
+    condition_variable not_empty, not_full;
+    deque <vector<ACCESS_RECORD> > pending;
+    vector <vector<ACCESS_RECORD> > spare; // written blocks, reused so that submit does not allocate
+    uint8_t stop;
+
+    void write();
+};
+
+// ACCESS STREAM
+// the buffer one cache or the DRAM records into; whole blocks go to the writer, so caches
+// run by different threads with -threaded only meet on the writer's lock once per block
+class ACCESS_STREAM {
+  public:
+    ACCESS_STREAM_WRITER *writer;
+    vector <ACCESS_RECORD> block;
+
+    ACCESS_STREAM(ACCESS_STREAM_WRITER *w) : writer(w) {
+        block.reserve(ACCESS_STREAM_BLOCK_RECORDS);
+    }
+
+    void record(PACKET *packet, uint8_t hit),
+         flush();
+};
+
+// ACCESS STREAM READER
+// reads a recorded stream back one record at a time
+class ACCESS_STREAM_READER {
+  public:
+    string filename, level;
+
+    ACCESS_STREAM_READER(string name);
+    ~ACCESS_STREAM_READER();
+
+    // 1 with the next record, 0 at the end of the stream
+    int next(ACCESS_RECORD &record);
+
+  private:
+    FILE *file;
+    vector <ACCESS_RECORD> block;
+    vector <uint8_t> compressed, shuffled;
+    size_t pos;
+};
+
+#endif
@@ -274,15 +274,15 @@ class CORE_BUFFER {
              inorder_fetch[2],
              next_fetch[2],
              next_schedule;
-    uint64_t event_cycle,
-             fetch_event_cycle,
-             schedule_event_cycle,
-             execute_event_cycle,
-             lsq_event_cycle,
-             retire_event_cycle;
 
+    // the instructions, with their operands and dependencies
     ooo_model_instr *entry;
 
+    // the pipeline state of each entry, kept apart from entry so that the loops over the ROB read a few dense arrays
+    // executed is set after all dependencies are eliminated and the instruction is chosen on a cycle, according to EXEC_WIDTH
+    uint64_t *event_cycle;
+    uint8_t  *translated, *fetched, *scheduled, *executed, *reg_ready;
+
     // constructor
     CORE_BUFFER(string v1, uint32_t v2) : NAME(v1), SIZE(v2) {
         head = 0;
@@ -299,19 +299,38 @@ class CORE_BUFFER {
         next_fetch[1] = 0;
         next_schedule = 0;
 
-        event_cycle = 0;
-        fetch_event_cycle = UINT64_MAX;
-        schedule_event_cycle = UINT64_MAX;
-        execute_event_cycle = UINT64_MAX;
-        lsq_event_cycle = UINT64_MAX;
-        retire_event_cycle = UINT64_MAX;
-
         entry = new ooo_model_instr[SIZE];
+
+        event_cycle = new uint64_t[SIZE];
+        translated = new uint8_t[SIZE];
+        fetched = new uint8_t[SIZE];
+        scheduled = new uint8_t[SIZE];
+        executed = new uint8_t[SIZE];
+        reg_ready = new uint8_t[SIZE];
+        for (uint32_t i=0; i<SIZE; i++)
+            clear_state(i);
     };
 
     // destructor
     ~CORE_BUFFER() {
         delete[] entry;
+
+        delete[] event_cycle;
+        delete[] translated;
+        delete[] fetched;
+        delete[] scheduled;
+        delete[] executed;
+        delete[] reg_ready;
+    };
+
+    // reset the pipeline state of entry n
+    void clear_state(uint32_t n) {
+        event_cycle[n] = 0;
+        translated[n] = 0;
+        fetched[n] = 0;
+        scheduled[n] = 0;
+        executed[n] = 0;
+        reg_ready[n] = 0;
     };
 };
 
@@ -2,6 +2,8 @@
 #define CACHE_H
 
 #include "memory_class.h"
+#include "module.h"
+#include "access_stream.h"
 
 // PAGE
 extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
@@ -84,11 +86,19 @@ class CACHE : public MEMORY {
     const string NAME;
     const uint32_t NUM_SET, NUM_WAY, NUM_LINE, WQ_SIZE, RQ_SIZE, PQ_SIZE, MSHR_SIZE;
     uint32_t LATENCY;
+    uint64_t SET_MASK;
     BLOCK **block;
     int fill_level;
     uint32_t MAX_READ, MAX_FILL;
     uint8_t cache_type;
 
+    // chosen at startup, see module.h
+    PREFETCHER *prefetcher;
+    REPLACEMENT *replacement;
+
+    // set by -record_stream, see access_stream.h
+    ACCESS_STREAM *stream;
+
     // prefetch stats
     uint64_t pf_requested,
              pf_issued,
@@ -116,10 +126,15 @@ class CACHE : public MEMORY {
 
         LATENCY = 0;
 
+        // the set index keeps the low lg2(NUM_SET) bits of the block address
+        SET_MASK = (1 << lg2(NUM_SET)) - 1;
+
         // cache block
+        // one contiguous array, block[set] points at the first way of each set
         block = new BLOCK* [NUM_SET];
+        block[0] = new BLOCK[NUM_SET*NUM_WAY];
         for (uint32_t i=0; i<NUM_SET; i++) {
-            block[i] = new BLOCK[NUM_WAY]; 
+            block[i] = block[0] + i*NUM_WAY;
 
             for (uint32_t j=0; j<NUM_WAY; j++) {
                 block[i][j].lru = j;
@@ -142,6 +157,9 @@ class CACHE : public MEMORY {
 
         lower_level = NULL;
         extra_interface = NULL;
+        prefetcher = NULL;
+        replacement = NULL;
+        stream = NULL;
         fill_level = -1;
         MAX_READ = 1;
         MAX_FILL = 1;
@@ -155,8 +173,7 @@ class CACHE : public MEMORY {
 
     // destructor
     ~CACHE() {
-        for (uint32_t i=0; i<NUM_SET; i++)
-            delete[] block[i];
+        delete[] block[0];
         delete[] block;
     };
 
@@ -167,11 +184,14 @@ class CACHE : public MEMORY {
 
     void return_data(PACKET *packet),
          operate(),
-         increment_WQ_FULL(uint64_t address);
+         increment_WQ_FULL(uint64_t address),
+         warm_access(PACKET *packet);
 
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
 
+    uint64_t get_next_event_cycle();
+
     int  check_hit(PACKET *packet),
          invalidate_entry(uint64_t inval_addr),
          check_mshr(PACKET *packet),
@@ -192,18 +212,12 @@ class CACHE : public MEMORY {
          fill_cache(uint32_t set, uint32_t way, PACKET *packet),
          replacement_final_stats(),
          llc_replacement_final_stats(),
-         //prefetcher_initialize(),
-         l1d_prefetcher_initialize(),
-         l2c_prefetcher_initialize(),
-         llc_prefetcher_initialize(),
+         prefetcher_initialize(),
          prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
          l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
          prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr),
          l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
-         //prefetcher_final_stats(),
-         l1d_prefetcher_final_stats(),
-         l2c_prefetcher_final_stats(),
-         llc_prefetcher_final_stats();
+         prefetcher_final_stats();
 
     uint32_t l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
          llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
@@ -212,6 +226,7 @@ class CACHE : public MEMORY {
     
     uint32_t get_set(uint64_t address),
              get_way(uint64_t address, uint32_t set),
+             find_way(uint32_t set, uint64_t tag),
              find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type),
              llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type),
              lru_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
@@ -15,6 +15,7 @@
 #include <iostream>
 #include <queue>
 #include <map>
+#include <vector>
 #include <random>
 #include <string>
 #include <iomanip>
@@ -33,7 +34,10 @@
 #endif
 
 // CPU
+// the core count and DRAM channels can be set from the build, see build_champsim.sh
+#ifndef NUM_CPUS
 #define NUM_CPUS 1
+#endif
 #define CPU_FREQ 5000
 #define DRAM_IO_FREQ 1600
 #define PAGE_SIZE 4096
@@ -55,8 +59,10 @@
 #define FILL_DRAM 16
 
 // DRAM
+#ifndef DRAM_CHANNELS
 #define DRAM_CHANNELS 1      // default: assuming one DIMM per one channel 4GB * 1 => 4GB off-chip memory
 #define LOG2_DRAM_CHANNELS 0
+#endif
 #define DRAM_RANKS 8         // 512MB * 8 ranks => 4GB per DIMM
 #define LOG2_DRAM_RANKS 3
 #define DRAM_BANKS 8         // 64MB * 8 banks => 512MB per rank
@@ -79,7 +85,10 @@ extern uint8_t warmup_complete[NUM_CPUS],
                all_simulation_complete,
                MAX_INSTR_DESTINATIONS,
                knob_cloudsuite,
-               knob_low_bandwidth;
+               knob_low_bandwidth,
+               knob_event_skip,
+               knob_threaded,
+               knob_memory_only;
 
 extern uint64_t current_core_cycle[NUM_CPUS], 
                 stall_cycle[NUM_CPUS], 
@@ -115,4 +124,12 @@ class RANDOM {
     };
 };
 extern uint64_t champsim_seed;
+
+// libc rand() that counts its draws, so that a checkpoint can put rand() back where it was
+extern uint64_t libc_rand_draws;
+inline int counted_rand()
+{
+    libc_rand_draws++;
+    return rand();
+}
 #endif
@@ -0,0 +1,56 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "champsim.h"
+#include <functional>
+
+// piece of simulator state saved under a unique name
+class CHECKPOINT_SECTION {
+  public:
+    string name;
+
+    // plain tables are copied as they are (size > 0) ...
+    void *data;
+    uint64_t size;
+
+    // ... anything else encodes itself
+    function<void(vector<uint8_t> &)> save;
+    function<void(const vector<uint8_t> &)> load;
+};
+
+// CHECKPOINT
+// warm state written by -save_checkpoint right after the warmup and read back by -load_checkpoint.
+// every module adds its own sections once (caches and page table from main, predictors, prefetchers and
+// replacement policies from their initialize functions), so a checkpoint can be loaded into a binary
+// with a different prefetcher or policy: sections nobody asks for are skipped, missing ones stay cold
+class CHECKPOINT {
+  public:
+    vector <CHECKPOINT_SECTION> section;
+
+    void add_section(string name, void *data, uint64_t size),
+         add_section(string name, function<void(vector<uint8_t> &)> save, function<void(const vector<uint8_t> &)> load),
+         save(string filename),
+         load(string filename);
+};
+
+extern CHECKPOINT checkpoint;
+
+// helpers for sections that encode themselves
+template <typename T>
+void checkpoint_put(vector<uint8_t> &buffer, const T &value)
+{
+    const uint8_t *bytes = (const uint8_t *)&value;
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T checkpoint_get(const vector<uint8_t> &buffer, uint64_t &offset)
+{
+    T value;
+    assert((offset + sizeof(T)) <= buffer.size());
+    memcpy(&value, &buffer[offset], sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define DRAM_H
 
 #include "memory_class.h"
+#include "access_stream.h"
 
 // DRAM configuration
 #define DRAM_CHANNEL_WIDTH 8 // 8B
@@ -33,6 +34,9 @@ class MEMORY_CONTROLLER : public MEMORY {
     uint32_t processed_writes, scheduled_reads[DRAM_CHANNELS], scheduled_writes[DRAM_CHANNELS];
     int fill_level;
 
+    // set by -record_stream, see access_stream.h
+    ACCESS_STREAM *stream;
+
     BANK_REQUEST bank_request[DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
 
     // queues
@@ -69,6 +73,7 @@ class MEMORY_CONTROLLER : public MEMORY {
         }
 
         fill_level = FILL_DRAM;
+        stream = NULL;
     };
 
     // destructor
@@ -83,7 +88,8 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     void return_data(PACKET *packet),
          operate(),
-         increment_WQ_FULL(uint64_t address);
+         increment_WQ_FULL(uint64_t address),
+         warm_access(PACKET *packet);
 
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
@@ -100,7 +106,8 @@ class MEMORY_CONTROLLER : public MEMORY {
              dram_get_column (uint64_t address),
              drc_check_hit (uint64_t address, uint32_t cpu, uint32_t channel, uint32_t rank, uint32_t bank, uint32_t row);
 
-    uint64_t get_bank_earliest_cycle();
+    uint64_t get_bank_earliest_cycle(),
+             get_next_event_cycle();
 
     int check_dram_queue(PACKET_QUEUE *queue, PACKET *packet);
 };
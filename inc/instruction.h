@@ -92,30 +92,25 @@ class ooo_model_instr {
              translated_cycle,
              fetched_cycle,
              execute_begin_cycle,
-             retired_cycle,
-             event_cycle;
+             retired_cycle;
 
     uint8_t is_branch,
             is_memory,
             branch_taken,
             branch_mispredicted,
-            translated,
             data_translated,
             source_added[NUM_INSTR_SOURCES],
             destination_added[NUM_INSTR_DESTINATIONS_SPARC],
             is_producer,
             is_consumer,
             reg_RAW_producer,
-            reg_ready,
             mem_ready,
             asid[2],
             reg_RAW_checked[NUM_INSTR_SOURCES];
 
-    uint32_t fetched, scheduled;
-    int num_reg_ops, num_mem_ops, num_reg_dependent;
+    // the pipeline state, translated, fetched, scheduled, executed, reg_ready and event_cycle, is in CORE_BUFFER
 
-    // executed bit is set after all dependencies are eliminated and this instr is chosen on a cycle, according to EXEC_WIDTH
-    int executed;
+    int num_reg_ops, num_mem_ops, num_reg_dependent;
 
     uint8_t destination_registers[NUM_INSTR_DESTINATIONS_SPARC]; // output registers
 
@@ -159,21 +154,15 @@ class ooo_model_instr {
         fetched_cycle = 0;
         execute_begin_cycle = 0;
         retired_cycle = 0;
-        event_cycle = 0;
 
         is_branch = 0;
         is_memory = 0;
         branch_taken = 0;
         branch_mispredicted = 0;
-        translated = 0;
         data_translated = 0;
         is_producer = 0;
         is_consumer = 0;
         reg_RAW_producer = 0;
-        fetched = 0;
-        scheduled = 0;
-        executed = 0;
-        reg_ready = 0;
         mem_ready = 0;
         asid[0] = UINT8_MAX;
         asid[1] = UINT8_MAX;
@@ -3,6 +3,9 @@
 
 #include "cache.h"
 
+// kpcp shares class names with spp_dev.h, keep them apart now that both are linked into one binary
+namespace kpcp {
+
 // L2 SPP
 //#define L2_PF_DEBUG_PRINT
 #ifdef L2_PF_DEBUG_PRINT
@@ -455,4 +458,6 @@ void notify_sampler(uint32_t cpu, int64_t address, int dirty, int useful)
     */
 }
 
+} // namespace kpcp
+
 #endif
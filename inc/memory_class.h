@@ -35,6 +35,9 @@ class MEMORY {
     virtual uint32_t get_occupancy(uint8_t queue_type, uint64_t address) = 0;
     virtual uint32_t get_size(uint8_t queue_type, uint64_t address) = 0;
 
+    // functional access used by -functional_warmup: updates contents and replacement state only, no queues or cycles
+    virtual void warm_access(PACKET *packet) = 0;
+
     // stats
     uint64_t ACCESS[NUM_TYPES], HIT[NUM_TYPES], MISS[NUM_TYPES], MSHR_MERGED[NUM_TYPES], STALL[NUM_TYPES];
 
@@ -0,0 +1,105 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include "block.h"
+
+class CACHE;
+class O3_CPU;
+
+// BRANCH PREDICTOR
+// one instance per core, chosen with -branch
+class BRANCH_PREDICTOR {
+  public:
+    O3_CPU *ooo;
+    uint32_t cpu;
+
+    virtual ~BRANCH_PREDICTOR() {};
+
+    virtual void initialize() {};
+    virtual uint8_t predict_branch(uint64_t ip) = 0;
+    virtual void last_branch_result(uint64_t ip, uint8_t taken) = 0;
+
+    // name of a checkpoint section that belongs to this instance
+    string section_name(string name);
+};
+
+// PREFETCHER
+// one instance per cache, chosen with -l1d_pref, -l2c_pref and -llc_pref
+// cpu is the core that owns the cache (0 for the LLC, which sees the requesting core in cache->cpu)
+class PREFETCHER {
+  public:
+    CACHE *cache;
+    uint32_t cpu;
+
+    virtual ~PREFETCHER() {};
+
+    virtual void initialize() {};
+    virtual uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in) = 0;
+    virtual uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in) { return metadata_in; };
+    virtual void final_stats() {};
+
+    int prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int prefetch_fill_level, uint32_t prefetch_metadata);
+    string section_name(string name);
+};
+
+// REPLACEMENT POLICY
+// one instance for the LLC, chosen with -llc_repl (the other caches use LRU)
+class REPLACEMENT {
+  public:
+    CACHE *cache;
+
+    virtual ~REPLACEMENT() {};
+
+    virtual void initialize() {};
+    virtual uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type) = 0;
+    virtual void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit) = 0;
+    virtual void final_stats() {};
+
+    string section_name(string name);
+};
+
+// MODULE REGISTRY
+// every module file registers a factory under its name before main runs, so that one binary carries all of them
+template <class T>
+class MODULE_REGISTRY {
+  public:
+    typedef T *(*FACTORY)();
+
+    static map <string, FACTORY> &factory() {
+        static map <string, FACTORY> registered;
+        return registered;
+    };
+
+    static int add(string name, FACTORY make) {
+        factory()[name] = make;
+        return 0;
+    };
+
+    static T *create(string name, string kind) {
+        typename map <string, FACTORY>::iterator it = factory().find(name);
+        if (it == factory().end()) {
+            cerr << "[MODULE] unknown " << kind << " " << name << ", available:";
+            for (it = factory().begin(); it != factory().end(); it++)
+                cerr << " " << it->first;
+            cerr << endl;
+            assert(0);
+        }
+        return it->second();
+    };
+};
+
+// value-initialized, so module state starts zeroed like the globals it replaced
+template <class T, class U>
+T *make_module()
+{
+    return new U();
+}
+
+// prefetchers are registered per level (l1d, l2c or llc), the same name can have one implementation per level
+#define REGISTER_MODULE(base, name, type, tag) \
+    static int registered_##tag = MODULE_REGISTRY<base>::add(name, make_module<base, type>)
+#define REGISTER_BRANCH_PREDICTOR(name, type) REGISTER_MODULE(BRANCH_PREDICTOR, name, type, type)
+#define REGISTER_PREFETCHER(level, name, type) REGISTER_MODULE(PREFETCHER, string(#level) + "." + name, type, level##_##type)
+#define REGISTER_REPLACEMENT(name, type) REGISTER_MODULE(REPLACEMENT, name, type, type)
+
+#endif
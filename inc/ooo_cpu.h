@@ -2,6 +2,7 @@
 #define OOO_CPU_H
 
 #include "cache.h"
+#include "trace_reader.h"
 
 #ifdef CRC2_COMPILE
 #define STAT_PRINTING_PERIOD 1000000
@@ -25,27 +26,48 @@ using namespace std;
 
 #define STA_SIZE (ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC)
 
+// buckets of the store address table, a power of 2
+#define STORE_TABLE_SET 1024
+
+// trace records read and converted to ooo_model_instr at a time, ahead of handle_branch()
+#define DECODE_BATCH 64
+
 extern uint32_t SCHEDULING_LATENCY, EXEC_LATENCY;
 
+// -memory_only: an instruction in the window of operate_memory_only()
+class MEMORY_WINDOW_ENTRY {
+  public:
+    uint64_t ip, instr_id;
+    uint8_t  asid[2];
+    uint32_t pending_loads;
+    uint64_t store[NUM_INSTR_DESTINATIONS_SPARC]; // physical addresses, written to the L1D at retirement
+};
+
 // cpu
 class O3_CPU {
   public:
     uint32_t cpu;
 
     // trace
-    FILE *trace_file;
+    TRACE_READER *trace_file;
     char trace_string[1024];
-    char gunzip_command[1024];
 
     // instruction
     input_instr current_instr;
     cloudsuite_instr current_cloudsuite_instr;
+
+    // the batch of records read ahead: raw for skip_trace() and warm_trace(), decoded for handle_branch()
+    // decode_pos is the next record in program order, both views stay in step
+    vector <uint8_t> raw_batch;
+    vector <ooo_model_instr> decode_batch;
+    uint32_t decode_pos, decode_count;
     uint64_t instr_unique_id, completed_executions, 
              begin_sim_cycle, begin_sim_instr, 
              last_sim_cycle, last_sim_instr,
              finish_sim_cycle, finish_sim_instr,
              warmup_instructions, simulation_instructions, instrs_to_read_this_cycle, instrs_to_fetch_this_cycle,
-             next_print_instruction, num_retired;
+             next_print_instruction, num_retired,
+             skipped_instructions; // trace records before instr_id 0
     uint32_t inflight_reg_executions, inflight_mem_executions, num_searched;
     uint32_t next_ITLB_fetch;
 
@@ -56,6 +78,25 @@ class O3_CPU {
     // store array, this structure is required to properly handle store instructions
     uint64_t STA[STA_SIZE], STA_head, STA_tail; 
 
+    // register alias table, RAT[r] is the ROB entry of the youngest instruction in the ROB that writes register r (ROB_SIZE for none)
+    // RAT_source[n][j] is what RAT held for source j of ROB entry n when the instruction was added to the ROB
+    uint32_t RAT[256], RAT_source[ROB_SIZE][NUM_INSTR_SOURCES];
+
+    // store address table, the stores in the ROB hashed by virtual address for the memory RAW checks
+    // node n is destination n%NUM_INSTR_DESTINATIONS_SPARC of ROB entry n/NUM_INSTR_DESTINATIONS_SPARC,
+    // each bucket is a doubly linked list of nodes, youngest first (UINT32_MAX ends a list)
+    uint32_t store_table[STORE_TABLE_SET],
+             store_table_next[ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC], store_table_prev[ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC];
+
+    // free LQ entries, bit n of LQ_free[n/64] is set when LQ.entry[n] is free
+    uint64_t LQ_free[(LQ_SIZE+63)/64];
+
+    // pending completions, a binary min-heap of the (event_cycle, rob_index) of the ROB entries that are executing
+    // an entry can be in here more than once or under an event_cycle that has since moved later,
+    // update_rob() checks it again when it comes up
+    vector <pair<uint64_t, uint32_t> > completion_queue;
+    vector <uint32_t> completion_due;
+
     // Ready-To-Execute
     uint32_t RTE0[ROB_SIZE], RTE0_head, RTE0_tail, 
              RTE1[ROB_SIZE], RTE1_head, RTE1_tail;  
@@ -68,11 +109,21 @@ class O3_CPU {
     uint32_t RTS0[SQ_SIZE], RTS0_head, RTS0_tail,
              RTS1[SQ_SIZE], RTS1_head, RTS1_tail;
 
+    // -memory_only core: ROB_SIZE instructions in flight and at most LQ_SIZE loads in the L1D,
+    // memory_load_window[n] is the window entry of load n (UINT32_MAX when n is free)
+    // memory_register_load[r] is the last load instruction register r was computed from (UINT64_MAX for none)
+    MEMORY_WINDOW_ENTRY memory_window[ROB_SIZE];
+    uint32_t memory_window_head, memory_window_occupancy,
+             memory_load_window[LQ_SIZE], memory_free_loads;
+    uint64_t memory_register_load[256];
+
     // branch
     int branch_mispredict_stall_fetch; // flag that says that we should stall because a branch prediction was wrong
     int mispredicted_branch_iw_index; // index in the instruction window of the mispredicted branch.  fetch resumes after the instruction at this index executes
-    uint8_t  fetch_stall;
+    uint8_t  fetch_stall,
+             fetch_drain; // sampled simulation: stop reading the trace until the pipeline is empty
     uint64_t num_branch, branch_mispredictions;
+    BRANCH_PREDICTOR *branch_predictor; // chosen at startup, see module.h
 
     // TLBs and caches
     CACHE ITLB{"ITLB", ITLB_SET, ITLB_WAY, ITLB_SET*ITLB_WAY, ITLB_WQ_SIZE, ITLB_RQ_SIZE, ITLB_PQ_SIZE, ITLB_MSHR_SIZE},
@@ -88,6 +139,9 @@ class O3_CPU {
 
         // trace
         trace_file = NULL;
+        decode_batch.resize(DECODE_BATCH);
+        decode_pos = 0;
+        decode_count = 0;
 
         // instruction
         instr_unique_id = 0;
@@ -105,6 +159,7 @@ class O3_CPU {
 
         next_print_instruction = STAT_PRINTING_PERIOD;
         num_retired = 0;
+        skipped_instructions = 0;
 
         inflight_reg_executions = 0;
         inflight_mem_executions = 0;
@@ -112,18 +167,48 @@ class O3_CPU {
 
         next_ITLB_fetch = 0;
 
+        memory_window_head = 0;
+        memory_window_occupancy = 0;
+        for (uint32_t i=0; i<LQ_SIZE; i++)
+            memory_load_window[i] = UINT32_MAX;
+        memory_free_loads = LQ_SIZE;
+        for (uint32_t i=0; i<256; i++)
+            memory_register_load[i] = UINT64_MAX;
+
         // branch
         branch_mispredict_stall_fetch = 0;
         mispredicted_branch_iw_index = 0;
         fetch_stall = 0;
+        fetch_drain = 0;
         num_branch = 0;
         branch_mispredictions = 0;
+        branch_predictor = NULL;
 
         for (uint32_t i=0; i<STA_SIZE; i++)
             STA[i] = UINT64_MAX;
         STA_head = 0;
         STA_tail = 0;
 
+        for (uint32_t i=0; i<256; i++)
+            RAT[i] = ROB_SIZE;
+        for (uint32_t i=0; i<ROB_SIZE; i++) {
+            for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++)
+                RAT_source[i][j] = ROB_SIZE;
+        }
+
+        for (uint32_t i=0; i<STORE_TABLE_SET; i++)
+            store_table[i] = UINT32_MAX;
+        for (uint32_t i=0; i<ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC; i++) {
+            store_table_next[i] = UINT32_MAX;
+            store_table_prev[i] = UINT32_MAX;
+        }
+
+        for (uint32_t i=0; i<LQ_SIZE; i++) {
+            if ((i % 64) == 0)
+                LQ_free[i/64] = 0;
+            LQ_free[i/64] |= (1ull << (i % 64));
+        }
+
         for (uint32_t i=0; i<ROB_SIZE; i++) {
             RTE0[i] = ROB_SIZE;
             RTE1[i] = ROB_SIZE;
@@ -165,6 +250,8 @@ class O3_CPU {
          do_memory_scheduling(uint32_t rob_index),
          operate_lsq(),
          complete_execution(uint32_t rob_index),
+         add_completion(uint32_t rob_index),
+         remove_completion(),
          reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t source_index),
          reg_RAW_release(uint32_t rob_index),
          mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_index, uint32_t lq_index),
@@ -175,15 +262,27 @@ class O3_CPU {
          complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb),
          complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb);
 
-    void initialize_core();
+    void initialize_core(),
+         operate_memory_only(),
+         complete_memory_load(uint32_t load);
+    int      memory_load_pending(uint64_t instr_id);
+    uint64_t translate_data(ooo_model_instr *arch_instr, uint64_t virtual_address);
+    uint32_t fill_decode_batch();
+    uint64_t read_trace(void *data, uint64_t count);
+    void skip_trace(uint64_t num_skip, uint8_t translate);
+    void warm_trace(uint64_t num_warm);
     void add_load_queue(uint32_t rob_index, uint32_t data_index),
          add_store_queue(uint32_t rob_index, uint32_t data_index),
+         add_store_address(uint32_t rob_index),
+         release_store_address(uint32_t rob_index),
          execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_index);
     int  execute_load(uint32_t rob_index, uint32_t sq_index, uint32_t data_index);
+    uint32_t store_address_set(uint64_t address);
     void check_dependency(int prior, int current);
     void operate_cache();
     void update_rob();
     void retire_rob();
+    uint64_t get_next_event_cycle();
 
     uint32_t  add_to_rob(ooo_model_instr *arch_instr),
               check_rob(uint64_t instr_id);
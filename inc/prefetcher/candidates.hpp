@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <array>
 
+#include "champsim.h"
 #include "prefetcher/int.hpp"
 #include "prefetcher/optional.hpp"
 #include "prefetcher/saturating_counter.hpp"
@@ -56,7 +57,7 @@ class Candidates {
                 candidate = std::distance(m_lru.begin(), deallocate_it);
             } else {
                 std::fill(m_lru.begin(), m_lru.end(), 0);
-                candidate = std::rand() % N;
+                candidate = counted_rand() % N;
             }
             m_allocated[candidate] = false;
         }
@@ -5,6 +5,7 @@
 #include <queue>
 #include <unordered_map>
 
+#include "checkpoint.h"
 #include "prefetcher/int.hpp"
 #include "prefetcher/optional.hpp"
 #include "prefetcher/saturating_counter.hpp"
@@ -60,6 +61,44 @@ class Streams {
                 if (kv.second.has_value() && kv.second.value() == stream)
                     kv.second = {};
         }
+
+        // Checkpoint encoding: the issued cache lines, oldest first. A line
+        // issued twice may already have lost its entry to the older copy.
+        void save(std::vector<u8>& buffer) const {
+            auto issued_queue = m_issued_queue;
+            checkpoint_put(buffer, (u64)issued_queue.size());
+            for (; !issued_queue.empty(); issued_queue.pop()) {
+                auto cache_line = issued_queue.front();
+                auto it = m_issued.find(cache_line);
+                bool tracked = it != m_issued.end();
+                checkpoint_put(buffer, cache_line);
+                checkpoint_put(buffer, tracked);
+                if (!tracked) continue;
+                checkpoint_put(buffer, m_filled.at(cache_line));
+                checkpoint_put(buffer, it->second.has_value());
+                checkpoint_put(buffer, it->second.has_value()
+                                           ? it->second.value()
+                                           : (Stream)0);
+            }
+        }
+
+        void load(const std::vector<u8>& buffer, u64& offset) {
+            m_filled.clear();
+            m_issued.clear();
+            m_issued_queue = std::queue<u64>();
+            auto size = checkpoint_get<u64>(buffer, offset);
+            for (u64 i = 0; i < size; ++i) {
+                auto cache_line = checkpoint_get<u64>(buffer, offset);
+                m_issued_queue.push(cache_line);
+                if (!checkpoint_get<bool>(buffer, offset)) continue;
+                auto filled = checkpoint_get<bool>(buffer, offset);
+                auto has_stream = checkpoint_get<bool>(buffer, offset);
+                auto stream = checkpoint_get<Stream>(buffer, offset);
+                m_filled[cache_line] = filled;
+                m_issued[cache_line] =
+                    has_stream ? Optional<Stream>(stream) : Optional<Stream>();
+            }
+        }
     };
 
     // Stream eviction.
@@ -226,4 +265,35 @@ class Streams {
     }
 
     void fill(u64 cache_line) { m_issued.fill(cache_line); }
+
+    // Checkpoint encoding.
+    void save(std::vector<u8>& buffer) const {
+        checkpoint_put(buffer, m_useful);
+        checkpoint_put(buffer, m_allocated);
+        checkpoint_put(buffer, m_last_cache_line);
+        checkpoint_put(buffer, m_direction);
+        checkpoint_put(buffer, m_distance);
+        checkpoint_put(buffer, m_degree);
+        checkpoint_put(buffer, m_num_issued);
+        checkpoint_put(buffer, m_num_useful);
+        checkpoint_put(buffer, m_num_timely);
+        checkpoint_put(buffer, m_num_access);
+        m_issued.save(buffer);
+    }
+
+    void load(const std::vector<u8>& buffer) {
+        u64 offset = 0;
+        m_useful = checkpoint_get<decltype(m_useful)>(buffer, offset);
+        m_allocated = checkpoint_get<decltype(m_allocated)>(buffer, offset);
+        m_last_cache_line =
+            checkpoint_get<decltype(m_last_cache_line)>(buffer, offset);
+        m_direction = checkpoint_get<decltype(m_direction)>(buffer, offset);
+        m_distance = checkpoint_get<decltype(m_distance)>(buffer, offset);
+        m_degree = checkpoint_get<decltype(m_degree)>(buffer, offset);
+        m_num_issued = checkpoint_get<decltype(m_num_issued)>(buffer, offset);
+        m_num_useful = checkpoint_get<decltype(m_num_useful)>(buffer, offset);
+        m_num_timely = checkpoint_get<decltype(m_num_timely)>(buffer, offset);
+        m_num_access = checkpoint_get<decltype(m_num_access)>(buffer, offset);
+        m_issued.load(buffer, offset);
+    }
 };
@@ -0,0 +1,40 @@
+#ifndef PREFETCHER_REPLAY_H
+#define PREFETCHER_REPLAY_H
+
+#include "ooo_cpu.h"
+
+// PREFETCHER REPLAY
+// -prefetcher_replay l1d|l2c runs the trace's data accesses through one prefetcher and idealized tag stores instead of
+// simulating it: no queues, MSHRs or cycles, prefetches fill as soon as they are issued. the L1D prefetcher sees every
+// load, the L2C prefetcher the loads that miss a plain LRU L1D. stats cover the simulation instructions after the warmup.
+// with -replay_stream FILE the accesses come from a stream -record_stream wrote at that level instead (see access_stream.h)
+
+// a prefetch used less than this many instructions after it was issued would likely have been late
+#define REPLAY_LATE_INSTRUCTIONS 100
+#define REPLAY_DISTANCE_BUCKETS 24
+
+class REPLAY_BLOCK {
+  public:
+    uint64_t line, lru, pf_instr; // pf_instr: instruction that prefetched the block
+    uint8_t valid, prefetch;
+};
+
+// set-associative LRU tag store with the geometry of a cache
+class REPLAY_CACHE {
+  public:
+    uint32_t num_set, num_way;
+    uint64_t lru_clock;
+    vector <REPLAY_BLOCK> block; // set after set
+
+    REPLAY_CACHE(uint32_t sets, uint32_t ways) : num_set(sets), num_way(ways), lru_clock(0), block(sets * ways) {}
+
+    // way of line in its set, -1 on a miss; a hit becomes the most recently used
+    int lookup(uint64_t line);
+
+    // puts line in the LRU way of its set and returns what was there
+    REPLAY_BLOCK fill(uint64_t line, uint8_t prefetch, uint64_t pf_instr, uint32_t &way);
+};
+
+void replay_prefetcher(string level, string stream_file, uint64_t num_warm, uint64_t num_measure);
+
+#endif
@@ -12,10 +12,18 @@
 #include <string.h>
 
 #define TYPE	unsigned short int
-//#define MAX_SIZE	ROB_SIZE
-// sethpugsley - changed this from ROB_SIZE to allow for non-power-of-2 ROB sizes, like real CPUs have
-// but MAX_SIZE here still requires a power-of-2 number
-#define MAX_SIZE	256
+
+// the largest index a set holds is the largest of the ROB, LQ and SQ, rounded up to whole 64 bit words
+// (it used to be fixed at 256, which capped ROB_SIZE)
+#if !defined(ROB_SIZE) || !defined(LQ_SIZE) || !defined(SQ_SIZE)
+#error "set.h needs ROB_SIZE, LQ_SIZE and SQ_SIZE, include instruction.h"
+#endif
+#define SET_MAX_INDEX	((ROB_SIZE > LQ_SIZE) ? ((ROB_SIZE > SQ_SIZE) ? ROB_SIZE : SQ_SIZE) : ((LQ_SIZE > SQ_SIZE) ? LQ_SIZE : SQ_SIZE))
+#define MAX_SIZE	(((SET_MAX_INDEX) + 63) / 64 * 64)
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 // tuned empirically
 
@@ -46,7 +54,7 @@ class fastset {
 
 	// get one of the bits
 
-	bool getbit (TYPE x) {
+	bool getbit (TYPE x) const {
 		int word = x >> 6;
 		int bit = x & 63;
 		return (data.bits[word] >> bit) & 1;
@@ -73,7 +81,7 @@ class fastset {
 
 	// do a linear search in a small set
 
-	bool search_small_linear (TYPE x) {
+	bool search_small_linear (TYPE x) const {
 		for (int i=0; i<card; i++) {
 			TYPE y = data.values[i];
 			if (y > x) return false;
@@ -85,7 +93,7 @@ class fastset {
 
 	// search a small set, specializing for the set size
 
-	bool search_small (TYPE x) {
+	bool search_small (TYPE x) const {
 
 		// no elements? we're done.
 
@@ -166,7 +174,7 @@ public:
 
 	// search the set for a value
 
-	bool search (TYPE x) {
+	bool search (TYPE x) const {
 		//assert (x < MAX_SIZE);
 
 		// empty?
@@ -207,52 +215,78 @@ public:
 			assert (other.card >= SMALL_SIZE);
 		}
 
-		// lim is the next multiple of 64
+		// lim is the number of words holding indices below n
 
-		int lim = ((n | 63) + 1) / 64;
+		int lim = (n + 63) / 64;
 
 		// bitwise OR the other bits into this set
-		for (int i=0; i<lim; i++) data.bits[i] |= other.data.bits[i];
+		int i = 0;
+#ifdef __AVX2__
+		for (; i+4<=lim; i+=4) {
+			__m256i a = _mm256_loadu_si256 ((__m256i *) &data.bits[i]);
+			__m256i b = _mm256_loadu_si256 ((__m256i *) &other.data.bits[i]);
+			_mm256_storeu_si256 ((__m256i *) &data.bits[i], _mm256_or_si256 (a, b));
+		}
+#endif
+		for (; i<lim; i++) data.bits[i] |= other.data.bits[i];
 	}
 
-	// expand the entire set into the array v, returning the cardinality
+	// empty the set; the bits are cleared when it next becomes a bitset
 
-	int expand (TYPE v[], int n) {
-		if (!card) return 0;
+	void clear (void) { card = 0; }
 
-		// a small set can just be copied
+	// walk the members below n in increasing order without expanding the set
+	// into an array; the set must not gain new members during the walk
 
-		if (card < SMALL_SIZE) {
-			for (int i=0; i<card; i++) v[i] = data.values[i];
-			return card;
-		}
+	class cursor {
+		const fastset & owner;
+		int n, pos, value;
+		unsigned long long bits;	// the members of word pos not visited yet
 
-		// go through the bit array looking for elements
+	public:
+		cursor (const fastset & s, int lim) : owner (s), n (lim), pos (-1), value (-1), bits (0) { next (); }
 
-		int k = 0;
-		TYPE i;
-		for (i=0; i<n; i+=64) {
+		bool valid (void) const { return value >= 0; }
+
+		operator int (void) const { return value; }
 
-			// if this 64 bit subset is not empty, copy it into v
+		void next (void) {
+			if (owner.card < SMALL_SIZE) {
+				// a small set is sorted, so stop at the first value past n
+				pos++;
+				value = ((pos < owner.card) && (owner.data.values[pos] < n)) ? owner.data.values[pos] : -1;
+				return;
+			}
 
-			if (data.bits[i/64]) {
-				for (TYPE j=0; j<64; j++) {
-					TYPE l = i + j;
-					if (l < n) {
-						if (getbit (l)) v[k++] = l;
-					} else break;
+			// skip to the next word with members left
+			int lim = (n + 63) / 64;
+			while (!bits) {
+				if (++pos >= lim) {
+					value = -1;
+					return;
 				}
+				bits = owner.data.bits[pos];
 			}
+
+			value = pos*64 + __builtin_ctzll (bits);
+			bits &= bits - 1;
+			if (value >= n) value = -1;
 		}
+	};
+
+	// expand the entire set into the array v, returning the cardinality
+
+	int expand (TYPE v[], int n) const {
+		int k = 0;
+		for (cursor c (*this, n); c.valid (); c.next ()) v[k++] = c;
 		return k;
 	}
 };
 
 // this little macro iterates over either the whole set or just the single member
+// i is a fastset::cursor that converts to the current member
 
 #define ITERATE_SET(i,a,n) \
-	TYPE expand_##i[n+1]; \
-	int card_##i = (a).expand (expand_##i, n); \
-	for (int count_##i=0, i=expand_##i[0]; count_##i<card_##i; i=expand_##i[++count_##i])
+	for (fastset::cursor i ((a), (n)); i.valid (); i.next ())
 
 #endif
@@ -45,6 +45,11 @@
 #define GLOBAL_COUNTER_MAX ((1 << GLOBAL_COUNTER_BIT) - 1) 
 #define MAX_GHR_ENTRY 8
 
+// spp_dev shares class names with kpcp.h, keep them apart now that both are linked into one binary
+namespace spp_dev {
+
+class GLOBAL_REGISTER;
+
 enum FILTER_REQUEST {SPP_L2C_PREFETCH, SPP_LLC_PREFETCH, L2C_DEMAND, L2C_EVICT}; // Request type for prefetch filter
 uint64_t get_hash(uint64_t key);
 
@@ -73,7 +78,7 @@ class SIGNATURE_TABLE {
             }
     };
 
-    void read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t &last_sig, uint32_t &curr_sig, int32_t &delta);
+    void read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t &last_sig, uint32_t &curr_sig, int32_t &delta, GLOBAL_REGISTER &GHR);
 };
 
 class PATTERN_TABLE {
@@ -100,7 +105,7 @@ class PATTERN_TABLE {
     }
 
     void update_pattern(uint32_t last_sig, int curr_delta),
-         read_pattern(uint32_t curr_sig, int *prefetch_delta, uint32_t *confidence_q, uint32_t &lookahead_way, uint32_t &lookahead_conf, uint32_t &pf_q_tail, uint32_t &depth);
+         read_pattern(uint32_t curr_sig, int *prefetch_delta, uint32_t *confidence_q, uint32_t &lookahead_way, uint32_t &lookahead_conf, uint32_t &pf_q_tail, uint32_t &depth, GLOBAL_REGISTER &GHR);
 };
 
 class PREFETCH_FILTER {
@@ -121,7 +126,7 @@ class PREFETCH_FILTER {
 
     }
 
-    bool     check(uint64_t pf_addr, FILTER_REQUEST filter_request);
+    bool     check(uint64_t pf_addr, FILTER_REQUEST filter_request, GLOBAL_REGISTER &GHR);
 };
 
 class GLOBAL_REGISTER {
@@ -156,4 +161,6 @@ class GLOBAL_REGISTER {
     uint32_t check_entry(uint32_t page_offset);
 };
 
+} // namespace spp_dev
+
 #endif
@@ -0,0 +1,277 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include "champsim.h"
+#include "instruction.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <deque>
+#include <pthread.h>
+
+// decoded bytes are handed from the decoder thread to the core in chunks
+#define TRACE_CHUNK_SIZE (1 << 20)
+#define TRACE_CHUNKS 8
+
+// decoded chunks a shared trace keeps for cores that are behind, a core further back than this decodes on its own
+#define TRACE_SHARED_CHUNKS 256
+
+// seekable block format, see BLOCK_TRACE_READER
+#define BLOCK_TRACE_MAGIC "CHAMPBLK"
+#define BLOCK_TRACE_VERSION 1
+#define BLOCK_TRACE_STORED 0
+#define BLOCK_TRACE_ZLIB 1
+#define BLOCK_TRACE_RECORDS 0
+#define BLOCK_TRACE_COLUMNAR 1
+
+// columnar blocks, see encode_columns()
+#define NUM_TRACE_COLUMNS 5
+#define TRACE_COLUMN_IP_TABLE 1024
+
+// TRACE READER
+// open_trace() picks the reader from the file name: .blk files are block traces, anything else is a stream
+class TRACE_READER {
+  public:
+    string filename;
+    uint32_t record_size; // 0 when the format does not record it
+
+    virtual ~TRACE_READER() {};
+
+    // like fread: copies up to count records of size bytes and returns the number of whole records copied,
+    // fewer than count only at the end of the trace
+    virtual size_t read(void *data, size_t size, size_t count) = 0;
+
+    // moves num_bytes forward without copying them, returns the bytes skipped (fewer only at the end of the trace)
+    virtual uint64_t skip(uint64_t num_bytes) = 0;
+
+    // start over from the first record
+    virtual void restart() = 0;
+};
+
+TRACE_READER *open_trace(string filename);
+
+// like open_trace, but readers of the same .gz/.xz file share one decoder, see SHARED_TRACE_READER
+TRACE_READER *open_shared_trace(string filename);
+
+// STREAM TRACE READER
+// decompresses a .xz or .gz trace (anything else is read as it is) on its own thread, in process,
+// into a ring of TRACE_CHUNKS chunks that the core takes one whole chunk at a time
+class STREAM_TRACE_READER : public TRACE_READER {
+  public:
+    STREAM_TRACE_READER(string name);
+    ~STREAM_TRACE_READER();
+
+    size_t read(void *data, size_t size, size_t count);
+    uint64_t skip(uint64_t num_bytes);
+    void restart();
+
+  private:
+    thread decoder;
+    mutex lock;
+    condition_variable not_empty, not_full;
+
+    vector <vector<uint8_t> > ring;
+    uint32_t head, tail, occupancy;
+    uint8_t done, stop;
+
+    // chunk being read by the core
+    vector <uint8_t> current;
+    size_t current_pos;
+
+    void start(),
+         finish(),
+         decode(),
+         decode_xz(),
+         decode_gz();
+
+    // called by the decoder, swaps a full chunk into the ring, returns 0 once the reader is stopping
+    int push(vector <uint8_t> &chunk);
+    int next_chunk();
+};
+
+// SHARED TRACE
+// one decoding pass over a trace and the decoded chunks its readers have not all passed yet.
+// chunk n starts at byte n*TRACE_CHUNK_SIZE, the readers hold on to the chunk they are in
+class SHARED_TRACE_READER;
+
+class SHARED_TRACE {
+  public:
+    string filename;
+    TRACE_READER *source;
+    uint8_t done;
+
+    mutex lock;
+    uint64_t base; // number of chunks[0]
+    deque <shared_ptr<vector<uint8_t> > > chunks;
+    vector <SHARED_TRACE_READER *> readers;
+
+    SHARED_TRACE(string name, uint64_t first_chunk);
+    ~SHARED_TRACE();
+
+    // 1 with chunk n, 0 past the end of the trace, -1 when n is no longer kept
+    int get(uint64_t n, shared_ptr<vector<uint8_t> > &chunk);
+    void attach(SHARED_TRACE_READER *reader),
+         detach(SHARED_TRACE_READER *reader);
+
+  private:
+    void trim();
+};
+
+// SHARED TRACE READER
+// a core's cursor into a SHARED_TRACE; the last reader to leave a pass stops its decoder
+class SHARED_TRACE_READER : public TRACE_READER {
+  public:
+    uint64_t next_chunk; // chunk this reader needs after the current one, the pass keeps it until then
+
+    SHARED_TRACE_READER(string name);
+    ~SHARED_TRACE_READER();
+
+    size_t read(void *data, size_t size, size_t count);
+    uint64_t skip(uint64_t num_bytes);
+    void restart();
+
+  private:
+    shared_ptr<SHARED_TRACE> trace;
+    shared_ptr<vector<uint8_t> > current;
+    size_t current_pos;
+
+    void join();
+    int advance();
+};
+
+// TRACE SERVER
+// scripts/trace_server.cc decodes each trace once into a POSIX shared memory ring named after the trace file
+// (trace_server_name), and simulators run with -trace_server read the trace from there instead of decoding it.
+// the ring is TRACE_SERVER_SLOTS chunks; chunk n is in slot n % TRACE_SERVER_SLOTS, an empty chunk ends a pass
+// over the trace and the server starts the next pass right after it. the server only overwrites a chunk once
+// every attached reader is past it, and with no reader attached it stops while the start of a pass is in the ring
+#define TRACE_SERVER_MAGIC "CHAMPSHM"
+#define TRACE_SERVER_SLOTS 64
+#define TRACE_SERVER_READERS 64
+
+extern uint8_t knob_trace_server;
+
+string trace_server_name(string filename);
+
+class TRACE_SERVER_HEADER {
+  public:
+    char magic[8];
+    pid_t server_pid;
+
+    // every field below is under lock (robust and process-shared)
+    pthread_mutex_t lock;
+    pthread_cond_t produced_cond, consumed_cond;
+
+    uint64_t produced,    // chunks written so far
+             attach_chunk; // oldest pass start in the ring, where new readers begin
+    uint64_t chunk_size[TRACE_SERVER_SLOTS];
+
+    pid_t reader_pid[TRACE_SERVER_READERS]; // 0 for a free reader slot
+    uint64_t reader_chunk[TRACE_SERVER_READERS]; // chunk the reader is in
+};
+
+// TRACE SERVER
+// the writing side, one per trace; serve() runs until stop is set
+class TRACE_SERVER {
+  public:
+    TRACE_SERVER(string name);
+    ~TRACE_SERVER();
+
+    void serve(volatile uint8_t *stop);
+
+  private:
+    string filename, shm_name;
+    TRACE_READER *source;
+    TRACE_SERVER_HEADER *header;
+    uint8_t *slots;
+    uint64_t map_size;
+    deque <uint64_t> pass_start; // pass starts still in the ring
+
+    int can_write(uint64_t n);
+};
+
+// SERVED TRACE READER
+// reads a trace from its server's ring in place, read-only
+class SERVED_TRACE_READER : public TRACE_READER {
+  public:
+    // NULL when no server has the trace
+    static SERVED_TRACE_READER *attach(string filename);
+    ~SERVED_TRACE_READER();
+
+    size_t read(void *data, size_t size, size_t count);
+    uint64_t skip(uint64_t num_bytes);
+    void restart();
+
+  private:
+    TRACE_SERVER_HEADER *header;
+    const uint8_t *slots;
+    uint64_t map_size;
+    uint32_t reader;
+
+    // chunk being read; seeking skips to the start of the next pass
+    uint64_t chunk;
+    const uint8_t *current;
+    uint64_t current_size, current_pos;
+    uint8_t loaded, at_end, seeking;
+
+    SERVED_TRACE_READER() {};
+    int advance();
+};
+
+// BLOCK TRACE
+// header, then the records in blocks of records_per_block (the last one may be shorter), then one index entry per block.
+// blocks hold the records as they are or in columns (encoding), stored or deflated one by one (compression),
+// so any record is one index lookup and at most one block away
+class BLOCK_TRACE_HEADER {
+  public:
+    char magic[8];
+    uint32_t version, record_size, compression, encoding;
+    uint64_t records_per_block, num_records, num_blocks, index_offset;
+};
+
+class BLOCK_TRACE_INDEX {
+  public:
+    uint64_t offset, size; // where the block is in the file and how many bytes it takes there
+};
+
+// columnar encoding of one block of input_instr records, for smaller traces than the records themselves.
+// the block starts with the NUM_TRACE_COLUMNS column sizes (uint32_t, never compressed), then the columns:
+//   operands  1 byte per record: is_branch, branch_taken, then one bit per destination and source register that is not 0
+//   memory    1 byte per record: one bit per destination and source address that is not 0
+//   registers the register bytes that are not 0
+//   ip        zigzag varint delta from the previous record's ip
+//   addresses zigzag varint delta from the address in the same slot of the last record whose ip hashes the same
+// every block starts from ip 0 and an empty address table, so blocks decode on their own
+void encode_columns(const input_instr *records, uint64_t num_records, vector <uint8_t> &out);
+
+// decodes num_records records from the columns (without the column sizes), returns 0 if they do not add up
+int decode_columns(const uint32_t *column_size, const uint8_t *columns, input_instr *records, uint64_t num_records);
+
+// BLOCK TRACE READER
+// maps the whole file and reads it in place, skipping and restarting are seeks
+class BLOCK_TRACE_READER : public TRACE_READER {
+  public:
+    BLOCK_TRACE_READER(string name);
+    ~BLOCK_TRACE_READER();
+
+    size_t read(void *data, size_t size, size_t count);
+    uint64_t skip(uint64_t num_bytes);
+    void restart();
+
+  private:
+    uint8_t *map;
+    uint64_t map_size, block_bytes, total_bytes;
+    const BLOCK_TRACE_HEADER *header;
+    const BLOCK_TRACE_INDEX *index;
+
+    // block being read, its decoded bytes and the read position in them
+    uint64_t block;
+    const uint8_t *block_data;
+    uint64_t block_size, block_pos;
+    vector <uint8_t> inflated, decoded;
+
+    void load_block(uint64_t b);
+};
+
+#endif
@@ -6,8 +6,60 @@
 #include "dram_controller.h"
 //#include "drc_controller.h"
 
+#include <deque>
+
 //#define DRC_MSHR_SIZE 48
 
+// request held by an LLC port until the main thread hands it to the LLC
+class PORT_REQUEST {
+  public:
+    uint8_t queue_type; // 1: RQ, 2: WQ, 3: PQ (same encoding as get_occupancy)
+    uint64_t cycle;
+    PACKET packet;
+};
+
+// LLC PORT
+// with -threaded, each core runs on its own thread and its L2C talks to this port instead of the shared LLC.
+// requests and page walks are buffered here and drained by the main thread in cpu order, so the
+// shared LLC, DRAM and page table are only ever touched by one thread
+class LLC_PORT : public MEMORY {
+  public:
+    uint32_t cpu;
+    CACHE *stlb;
+
+    deque <PORT_REQUEST> request, walk;
+    uint32_t num_pending[4], num_other_pending[4];
+    uint64_t WQ_FULL;
+
+    LLC_PORT() {
+        cpu = 0;
+        stlb = NULL;
+        lower_level = NULL;
+        for (uint32_t i=0; i<4; i++) {
+            num_pending[i] = 0;
+            num_other_pending[i] = 0;
+        }
+        WQ_FULL = 0;
+    };
+
+    // functions
+    int  add_rq(PACKET *packet),
+         add_wq(PACKET *packet),
+         add_pq(PACKET *packet);
+
+    void return_data(PACKET *packet),
+         operate(),
+         increment_WQ_FULL(uint64_t address),
+         add_walk(PACKET *packet),
+         drain(uint64_t cycle),
+         warm_access(PACKET *packet);
+
+    uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
+             get_size(uint8_t queue_type, uint64_t address);
+
+    int add_request(uint8_t queue_type, PACKET *packet);
+};
+
 // uncore
 class UNCORE {
   public:
@@ -18,7 +70,12 @@ class UNCORE {
     // DRAM
     MEMORY_CONTROLLER DRAM{"DRAM"}; 
 
+    // per-core ports into the LLC (only used with -threaded)
+    LLC_PORT port[NUM_CPUS];
+
     UNCORE(); 
+
+    void update_port_view();
 };
 
 extern UNCORE uncore;
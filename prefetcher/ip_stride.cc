@@ -14,6 +14,7 @@
  */
 
 #include "cache.h"
+#include "checkpoint.h"
 
 #define IP_TRACKER_COUNT 1024
 #define PREFETCH_DEGREE 3
@@ -40,16 +41,27 @@ class IP_TRACKER {
     };
 };
 
-IP_TRACKER trackers[IP_TRACKER_COUNT];
+class IP_STRIDE : public PREFETCHER {
+  public:
+    IP_TRACKER trackers[IP_TRACKER_COUNT];
+
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    void final_stats();
+};
+
+REGISTER_PREFETCHER(l2c, "ip_stride", IP_STRIDE);
 
-void CACHE::l2c_prefetcher_initialize() 
+void IP_STRIDE::initialize() 
 {
     cout << "CPU " << cpu << " L2C IP-based stride prefetcher" << endl;
     for (int i=0; i<IP_TRACKER_COUNT; i++)
         trackers[i].lru = i;
+
+    checkpoint.add_section(section_name("ip_stride.trackers"), trackers, sizeof(trackers));
 }
 
-uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+uint32_t IP_STRIDE::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
 {
     // check for a tracker hit
     uint64_t cl_addr = addr >> LOG2_BLOCK_SIZE;
@@ -119,7 +131,7 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
                 break;
 
             // check the MSHR occupancy to decide if we're going to prefetch to the L2 or LLC
-            if (MSHR.occupancy < (MSHR.SIZE>>1))
+            if (cache->MSHR.occupancy < (cache->MSHR.SIZE>>1))
 	      prefetch_line(ip, addr, pf_address, FILL_L2, 0);
             else
 	      prefetch_line(ip, addr, pf_address, FILL_LLC, 0);
@@ -138,12 +150,7 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
     return metadata_in;
 }
 
-uint32_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
-{
-  return metadata_in;
-}
-
-void CACHE::l2c_prefetcher_final_stats()
+void IP_STRIDE::final_stats()
 {
     cout << "CPU " << cpu << " L2C PC-based stride prefetcher final stats" << endl;
 }
@@ -2,6 +2,9 @@
 
 #include "cache.h"
 #include "kpcp.h"
+#include "checkpoint.h"
+
+namespace kpcp {
 
 #define PF_THRESHOLD 25
 #define FILL_THRESHOLD 75
@@ -46,7 +49,18 @@ class PF_buffer {
 };
 PF_buffer pf_buffer[NUM_CPUS][L2C_MSHR_SIZE];
 
-void CACHE::l2c_prefetcher_initialize() 
+// the tables above are indexed by the core that owns the L2C
+class KPCP : public PREFETCHER {
+  public:
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in);
+    void final_stats();
+};
+
+REGISTER_PREFETCHER(l2c, "kpcp", KPCP);
+
+void KPCP::initialize() 
 {
     cout << "L2C Signature Path Prefetcher" << endl;
 
@@ -68,6 +82,13 @@ void CACHE::l2c_prefetcher_initialize()
         L2_GHR[cpu][i].lru = i;
 
     conf_counter[cpu] = 0;
+
+    checkpoint.add_section(section_name("kpcp.L2_ST"), L2_ST[cpu], sizeof(L2_ST[cpu]));
+    checkpoint.add_section(section_name("kpcp.L2_PT"), L2_PT[cpu], sizeof(L2_PT[cpu]));
+    checkpoint.add_section(section_name("kpcp.L2_GHR"), L2_GHR[cpu], sizeof(L2_GHR[cpu]));
+    checkpoint.add_section(section_name("kpcp.conf_counter"), &conf_counter[cpu], sizeof(conf_counter[cpu]));
+    checkpoint.add_section(section_name("kpcp.spp_pf_issued"), &spp_pf_issued[cpu], sizeof(spp_pf_issued[cpu]));
+    checkpoint.add_section(section_name("kpcp.spp_pf_useful"), &spp_pf_useful[cpu], sizeof(spp_pf_useful[cpu]));
 }
 
 void GHR_update(uint32_t cpu, int signature, int path_conf, int last_block, int oop_delta)
@@ -595,7 +616,7 @@ void L2_PT_update(uint32_t cpu, int signature, int delta)
 */
 
 // TODO: from here
-uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+uint32_t KPCP::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
 {
     // Check ST
     L2_ST_update(cpu, addr);
@@ -728,7 +749,7 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
     return metadata_in;
 }
 
-uint32_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+uint32_t KPCP::cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
 {
 	// L2 FILL
     uint64_t evicted_cl = evicted_addr >> LOG2_BLOCK_SIZE;
@@ -766,7 +787,7 @@ uint32_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t
     return metadata_in;
 }
 
-void CACHE::l2c_prefetcher_final_stats()
+void KPCP::final_stats()
 {
     cout << endl << "L2C Signature Path Prefetcher final stats" << endl;
 
@@ -783,3 +804,5 @@ void CACHE::l2c_prefetcher_final_stats()
         i, (100.0*useless_depth[cpu][i])/temp2, useless_depth[cpu][i]);
     */
 }
+
+} // namespace kpcp
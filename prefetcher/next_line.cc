@@ -0,0 +1,90 @@
+#include "cache.h"
+
+class L1D_NEXT_LINE : public PREFETCHER {
+  public:
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    void final_stats();
+};
+
+class L2C_NEXT_LINE : public PREFETCHER {
+  public:
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    void final_stats();
+};
+
+class LLC_NEXT_LINE : public PREFETCHER {
+  public:
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    void final_stats();
+};
+
+REGISTER_PREFETCHER(l1d, "next_line", L1D_NEXT_LINE);
+REGISTER_PREFETCHER(l2c, "next_line", L2C_NEXT_LINE);
+REGISTER_PREFETCHER(llc, "next_line", LLC_NEXT_LINE);
+
+void L1D_NEXT_LINE::initialize() 
+{
+    cout << "CPU " << cpu << " L1D next line prefetcher" << endl;
+}
+
+uint32_t L1D_NEXT_LINE::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+    uint64_t pf_addr = ((addr>>LOG2_BLOCK_SIZE)+1) << LOG2_BLOCK_SIZE;
+
+    DP ( if (warmup_complete[cpu]) {
+    cout << "[" << cache->NAME << "] " << __func__ << hex << " base_cl: " << (addr>>LOG2_BLOCK_SIZE);
+    cout << " pf_cl: " << (pf_addr>>LOG2_BLOCK_SIZE) << " ip: " << ip << " cache_hit: " << +cache_hit << " type: " << +type << endl; });
+
+    prefetch_line(ip, addr, pf_addr, FILL_L1, 0);
+
+    return metadata_in;
+}
+
+void L1D_NEXT_LINE::final_stats()
+{
+    cout << "CPU " << cpu << " L1D next line prefetcher final stats" << endl;
+}
+
+void L2C_NEXT_LINE::initialize() 
+{
+    cout << "CPU " << cpu << " L2C next line prefetcher" << endl;
+}
+
+uint32_t L2C_NEXT_LINE::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+    uint64_t pf_addr = ((addr>>LOG2_BLOCK_SIZE)+1) << LOG2_BLOCK_SIZE;
+
+    DP ( if (warmup_complete[cpu]) {
+    cout << "[" << cache->NAME << "] " << __func__ << hex << " base_cl: " << (addr>>LOG2_BLOCK_SIZE);
+    cout << " pf_cl: " << (pf_addr>>LOG2_BLOCK_SIZE) << " ip: " << ip << " cache_hit: " << +cache_hit << " type: " << +type << endl; });
+
+    prefetch_line(ip, addr, pf_addr, FILL_L2, 0);
+
+    return metadata_in;
+}
+
+void L2C_NEXT_LINE::final_stats()
+{
+    cout << "CPU " << cpu << " L2C next line prefetcher final stats" << endl;
+}
+
+void LLC_NEXT_LINE::initialize() 
+{
+    cout << "LLC Next Line Prefetcher" << endl;
+}
+
+uint32_t LLC_NEXT_LINE::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  uint64_t pf_addr = ((addr>>LOG2_BLOCK_SIZE)+1) << LOG2_BLOCK_SIZE;
+  prefetch_line(ip, addr, pf_addr, FILL_LLC, 0);
+
+  return metadata_in;
+}
+
+void LLC_NEXT_LINE::final_stats()
+{
+  cout << "LLC Next Line Prefetcher Final Stats: none" << endl;
+}
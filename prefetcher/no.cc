@@ -0,0 +1,14 @@
+#include "cache.h"
+
+// no prefetching, at any level
+class NO_PREFETCHER : public PREFETCHER {
+  public:
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+    {
+        return metadata_in;
+    };
+};
+
+REGISTER_PREFETCHER(l1d, "no", NO_PREFETCHER);
+REGISTER_PREFETCHER(l2c, "no", NO_PREFETCHER);
+REGISTER_PREFETCHER(llc, "no", NO_PREFETCHER);
@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <queue>
+#include <unordered_set>
+
+#include "cache.h"
+#include "checkpoint.h"
+#include "prefetcher/saturating_counter.hpp"
+
+#define ISSUED_QUEUE_SIZE 128
+
+// THRESHOLD is the number of useful prefetches per interval needed to increase
+// the distance.
+template <int THRESHOLD>
+class Problem1 : public PREFETCHER {
+   public:
+    // The prefetcher distance. The cache line offset is computed as 2^d.
+    saturating_counter<0, 3> m_distance{0};
+
+    // A queue of recently issued prefetches. Used to determine if a prefetch
+    // was useful.
+    std::unordered_multiset<uint16_t> m_issued;
+    std::queue<uint16_t> m_issued_queue;
+
+    // Number of useful prefetches within a given interval. A prefetch is useful
+    // if the cache line is accessed after the prefetch.
+    saturating_counter<0, THRESHOLD> m_useful{0};
+    saturating_counter<0, 511> m_access{0};
+
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit,
+                     uint8_t type, uint32_t metadata_in);
+    void final_stats();
+};
+
+typedef Problem1<15> Problem1Threshold16;
+typedef Problem1<64> Problem1Threshold64;
+typedef Problem1<128> Problem1Threshold128;
+
+REGISTER_PREFETCHER(l1d, "problem1_threshold16", Problem1Threshold16);
+REGISTER_PREFETCHER(l1d, "problem1_threshold64", Problem1Threshold64);
+REGISTER_PREFETCHER(l1d, "problem1_threshold128", Problem1Threshold128);
+
+template <int THRESHOLD>
+void Problem1<THRESHOLD>::initialize() {
+    cout << "CPU " << cpu << " L1D next line prefetcher" << endl;
+    m_issued.reserve(ISSUED_QUEUE_SIZE);
+
+    checkpoint.add_section(section_name("problem1.distance"), &m_distance,
+                           sizeof(m_distance));
+    checkpoint.add_section(section_name("problem1.useful"), &m_useful,
+                           sizeof(m_useful));
+    checkpoint.add_section(section_name("problem1.access"), &m_access,
+                           sizeof(m_access));
+    checkpoint.add_section(
+        section_name("problem1.issued"),
+        [this](std::vector<uint8_t>& buffer) {
+            auto issued_queue = m_issued_queue;
+            for (; !issued_queue.empty(); issued_queue.pop())
+                checkpoint_put(buffer, issued_queue.front());
+        },
+        [this](const std::vector<uint8_t>& buffer) {
+            m_issued.clear();
+            m_issued_queue = std::queue<uint16_t>();
+            for (uint64_t offset = 0; offset < buffer.size();) {
+                auto cache_line = checkpoint_get<uint16_t>(buffer, offset);
+                m_issued.insert(cache_line);
+                m_issued_queue.push(cache_line);
+            }
+        });
+}
+
+template <int THRESHOLD>
+uint32_t Problem1<THRESHOLD>::operate(uint64_t addr, uint64_t ip,
+                                      uint8_t cache_hit, uint8_t type,
+                                      uint32_t metadata_in) {
+    // A cache line was accessed.
+    ++m_access;
+
+    // Check if a prefetch was already issued.
+    uint64_t cache_line = addr >> LOG2_BLOCK_SIZE;
+    bool is_issued = m_issued.count(cache_line);
+
+    // If a prefetch was already issued, then the prefetch is useful.
+    if (is_issued) ++m_useful;
+
+    // If the monitoring interval is over, increase the distance if the
+    // prefetches have been useful, otherwise, decrease the distance.
+    if (m_access == m_access.max()) {
+        if (m_useful == m_useful.max())
+            ++m_distance;
+        else
+            --m_distance;
+        m_access = 0;
+        m_useful = 0;
+    }
+
+    // Compute the prefetch address.
+    uint64_t offset = 1 << m_distance;
+    uint64_t pf_cache_line = cache_line + offset;
+    uint64_t pf_addr = pf_cache_line << LOG2_BLOCK_SIZE;
+
+    // Do not repeat recent prefetches.
+    bool pf_is_issued = m_issued.count(pf_cache_line);
+    if (pf_is_issued) return metadata_in;
+
+    // Maintain queue of prefetched cache lines.
+    m_issued.insert(pf_cache_line);
+    m_issued_queue.push(pf_cache_line);
+    if (m_issued_queue.size() > ISSUED_QUEUE_SIZE) {
+        m_issued.erase(m_issued.find(m_issued_queue.front()));
+        m_issued_queue.pop();
+    }
+
+    prefetch_line(ip, addr, pf_addr, FILL_L1, 0);
+
+    return metadata_in;
+}
+
+template <int THRESHOLD>
+void Problem1<THRESHOLD>::final_stats() {
+    cout << "CPU " << cpu << " L1D next line prefetcher final stats" << endl;
+}
@@ -69,19 +69,48 @@
 // if the filled address was prefetched. Otherwise, set the bit to 0. The number
 // of demand misses is the total number of 1s.
 
-Streams<32> streams;
-Candidates<128> candidates;
+// NUM_CANDIDATES is the number of candidate streams in training, and
+// FALLBACK_DISTANCE is how far ahead an untrained access prefetches.
+template <usize NUM_CANDIDATES, i64 FALLBACK_DISTANCE>
+class Problem2 : public PREFETCHER {
+   public:
+    Streams<32> streams;
+    Candidates<NUM_CANDIDATES> candidates;
 
-void CACHE::l1d_prefetcher_initialize() {
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit,
+                     uint8_t type, uint32_t metadata_in);
+    uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way,
+                        uint8_t prefetch, uint64_t evicted_addr,
+                        uint32_t metadata_in);
+    void final_stats();
+};
+
+typedef Problem2<128, 1> Problem2Default;
+typedef Problem2<32, 16> Problem2Checkpoint;
+
+REGISTER_PREFETCHER(l1d, "problem2", Problem2Default);
+REGISTER_PREFETCHER(l1d, "problem2_checkpoint", Problem2Checkpoint);
+
+template <usize NUM_CANDIDATES, i64 FALLBACK_DISTANCE>
+void Problem2<NUM_CANDIDATES, FALLBACK_DISTANCE>::initialize() {
     cout << "CPU " << cpu << " L1D next line prefetcher" << endl;
-}
 
+    checkpoint.add_section(
+        section_name("problem2.streams"),
+        [this](std::vector<u8>& buffer) { streams.save(buffer); },
+        [this](const std::vector<u8>& buffer) { streams.load(buffer); });
+    checkpoint.add_section(section_name("problem2.candidates"), &candidates,
+                           sizeof(candidates));
+}
 // called when a tag is checked in the cache
 // this means (1) data is requested from cache, or (2) tag checked for
 // coherence address instruction pointer cache hit (y/n) type (load, write,
 // read for ownership, prefetch, translation)
-void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip,
-                                   uint8_t cache_hit, uint8_t type) {
+template <usize NUM_CANDIDATES, i64 FALLBACK_DISTANCE>
+uint32_t Problem2<NUM_CANDIDATES, FALLBACK_DISTANCE>::operate(
+    uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type,
+    uint32_t metadata_in) {
     uint64_t cache_line = addr >> LOG2_BLOCK_SIZE;
 
     // If there is an IP-based stream that prefetched the cache line
@@ -113,7 +142,7 @@ void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip,
                               FILL_L1, 0);
         } else {
             auto direction = hint.direction ? 1 : -1;
-            auto pf_cache_line = cache_line + direction;
+            auto pf_cache_line = cache_line + FALLBACK_DISTANCE * direction;
             prefetch_line(ip, addr, pf_cache_line << LOG2_BLOCK_SIZE, FILL_L1,
                           0);
         }
@@ -121,6 +150,8 @@ void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip,
 
     // If the monitoring period is over, update the streams.
     streams.train();
+
+    return metadata_in;
 }
 
 // called when a miss is filled in the cache
@@ -128,13 +159,16 @@ void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip,
 // set, way of fill (way is # ways if bypass)
 // prefetch (if addr was generated by prefetcher)
 // evicted_addr addr of evicted block
-void CACHE::l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way,
-                                      uint8_t prefetch, uint64_t evicted_addr,
-                                      uint32_t metadata_in) {
+template <usize NUM_CANDIDATES, i64 FALLBACK_DISTANCE>
+uint32_t Problem2<NUM_CANDIDATES, FALLBACK_DISTANCE>::cache_fill(
+    uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch,
+    uint64_t evicted_addr, uint32_t metadata_in) {
     u64 cache_line = addr >> LOG2_BLOCK_SIZE;
     if (prefetch) streams.fill(cache_line);
+    return metadata_in;
 }
 
-void CACHE::l1d_prefetcher_final_stats() {
+template <usize NUM_CANDIDATES, i64 FALLBACK_DISTANCE>
+void Problem2<NUM_CANDIDATES, FALLBACK_DISTANCE>::final_stats() {
     cout << "CPU " << cpu << " L1D next line prefetcher final stats" << endl;
 }
@@ -1,17 +1,32 @@
 #include "cache.h"
 #include "spp_dev.h"
+#include "checkpoint.h"
 
-SIGNATURE_TABLE ST;
-PATTERN_TABLE   PT;
-PREFETCH_FILTER FILTER;
-GLOBAL_REGISTER GHR;
+namespace spp_dev {
 
-void CACHE::l2c_prefetcher_initialize() 
-{
+class SPP : public PREFETCHER {
+  public:
+    SIGNATURE_TABLE ST;
+    PATTERN_TABLE   PT;
+    PREFETCH_FILTER FILTER;
+    GLOBAL_REGISTER GHR;
+
+    void initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in);
+};
+
+REGISTER_PREFETCHER(l2c, "spp_dev", SPP);
 
+void SPP::initialize() 
+{
+    checkpoint.add_section(section_name("spp_dev.ST"), &ST, sizeof(ST));
+    checkpoint.add_section(section_name("spp_dev.PT"), &PT, sizeof(PT));
+    checkpoint.add_section(section_name("spp_dev.FILTER"), &FILTER, sizeof(FILTER));
+    checkpoint.add_section(section_name("spp_dev.GHR"), &GHR, sizeof(GHR));
 }
 
-uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+uint32_t SPP::operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
 {
     uint64_t page = addr >> LOG2_PAGE_SIZE;
     uint32_t page_offset = (addr >> LOG2_BLOCK_SIZE) & (PAGE_SIZE / BLOCK_SIZE - 1),
@@ -38,10 +53,10 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
     // Stage 1: Read and update a sig stored in ST
     // last_sig and delta are used to update (sig, delta) correlation in PT
     // curr_sig is used to read prefetch candidates in PT 
-    ST.read_and_update_sig(page, page_offset, last_sig, curr_sig, delta);
+    ST.read_and_update_sig(page, page_offset, last_sig, curr_sig, delta, GHR);
 
     // Also check the prefetch filter in parallel to update global accuracy counters 
-    FILTER.check(addr, L2C_DEMAND); 
+    FILTER.check(addr, L2C_DEMAND, GHR); 
 
     // Stage 2: Update delta patterns stored in PT
     if (last_sig) PT.update_pattern(last_sig, delta);
@@ -57,7 +72,7 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
     do {
 #endif
         uint32_t lookahead_way = PT_WAY;
-        PT.read_pattern(curr_sig, delta_q, confidence_q, lookahead_way, lookahead_conf, pf_q_tail, depth);
+        PT.read_pattern(curr_sig, delta_q, confidence_q, lookahead_way, lookahead_conf, pf_q_tail, depth, GHR);
 
         do_lookahead = 0;
         for (uint32_t i = pf_q_head; i < pf_q_tail; i++) {
@@ -65,7 +80,7 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
                 uint64_t pf_addr = (base_addr & ~(BLOCK_SIZE - 1)) + (delta_q[i] << LOG2_BLOCK_SIZE);
 
                 if ((addr & ~(PAGE_SIZE - 1)) == (pf_addr & ~(PAGE_SIZE - 1))) { // Prefetch request is in the same physical page
-                    if (FILTER.check(pf_addr, ((confidence_q[i] >= FILL_THRESHOLD) ? SPP_L2C_PREFETCH : SPP_LLC_PREFETCH))) {
+                    if (FILTER.check(pf_addr, ((confidence_q[i] >= FILL_THRESHOLD) ? SPP_L2C_PREFETCH : SPP_LLC_PREFETCH), GHR)) {
 		      prefetch_line(ip, addr, pf_addr, ((confidence_q[i] >= FILL_THRESHOLD) ? FILL_L2 : FILL_LLC), 0); // Use addr (not base_addr) to obey the same physical page boundary
 
                         if (confidence_q[i] >= FILL_THRESHOLD) {
@@ -118,21 +133,16 @@ uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache
     return metadata_in;
 }
 
-uint32_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t match, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+uint32_t SPP::cache_fill(uint64_t addr, uint32_t set, uint32_t match, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
 {
 #ifdef FILTER_ON
     SPP_DP (cout << endl;);
-    FILTER.check(evicted_addr, L2C_EVICT);
+    FILTER.check(evicted_addr, L2C_EVICT, GHR);
 #endif
 
     return metadata_in;
 }
 
-void CACHE::l2c_prefetcher_final_stats()
-{
-
-}
-
 // TODO: Find a good 64-bit hash function
 uint64_t get_hash(uint64_t key)
 {
@@ -152,7 +162,7 @@ uint64_t get_hash(uint64_t key)
     return key;
 }
 
-void SIGNATURE_TABLE::read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t &last_sig, uint32_t &curr_sig, int32_t &delta)
+void SIGNATURE_TABLE::read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t &last_sig, uint32_t &curr_sig, int32_t &delta, GLOBAL_REGISTER &GHR)
 {
     uint32_t set = get_hash(page) % ST_SET,
              match = ST_WAY,
@@ -328,7 +338,7 @@ void PATTERN_TABLE::update_pattern(uint32_t last_sig, int curr_delta)
     }
 }
 
-void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int *delta_q, uint32_t *confidence_q, uint32_t &lookahead_way, uint32_t &lookahead_conf, uint32_t &pf_q_tail, uint32_t &depth)
+void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int *delta_q, uint32_t *confidence_q, uint32_t &lookahead_way, uint32_t &lookahead_conf, uint32_t &pf_q_tail, uint32_t &depth, GLOBAL_REGISTER &GHR)
 {
     // Update (sig, delta) correlation
     uint32_t set = get_hash(curr_sig) % PT_SET,
@@ -372,7 +382,7 @@ void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int *delta_q, uint32_t *conf
     } else confidence_q[pf_q_tail] = 0;
 }
 
-bool PREFETCH_FILTER::check(uint64_t check_addr, FILTER_REQUEST filter_request)
+bool PREFETCH_FILTER::check(uint64_t check_addr, FILTER_REQUEST filter_request, GLOBAL_REGISTER &GHR)
 {
     uint64_t cache_line = check_addr >> LOG2_BLOCK_SIZE,
              hash = get_hash(cache_line),
@@ -529,3 +539,5 @@ uint32_t GLOBAL_REGISTER::check_entry(uint32_t page_offset)
 
     return max_conf_way;
 }
+
+} // namespace spp_dev
@@ -1,4 +1,5 @@
 #include "cache.h"
+#include "checkpoint.h"
 
 #define maxRRPV 3
 #define NUM_POLICY 2
@@ -9,12 +10,24 @@
 #define PSEL_MAX ((1<<PSEL_WIDTH)-1)
 #define PSEL_THRS PSEL_MAX/2
 
-uint32_t rrpv[LLC_SET][LLC_WAY],
-         bip_counter = 0,
-         PSEL[NUM_CPUS];
-unsigned rand_sets[TOTAL_SDM_SETS];
+// PSEL and the leader sets are per requesting core
+class DRRIP : public REPLACEMENT {
+  public:
+    uint32_t rrpv[LLC_SET][LLC_WAY],
+             bip_counter,
+             PSEL[NUM_CPUS];
+    unsigned rand_sets[TOTAL_SDM_SETS];
 
-void CACHE::llc_initialize_replacement()
+    void initialize();
+    uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+    void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit);
+
+    int is_it_leader(uint32_t cpu, uint32_t set);
+};
+
+REGISTER_REPLACEMENT("drrip", DRRIP);
+
+void DRRIP::initialize()
 {
     cout << "Initialize DRRIP state" << endl;
 
@@ -24,7 +37,6 @@ void CACHE::llc_initialize_replacement()
     }
 
     // randomly selected sampler sets
-    srand(time(NULL));
     unsigned long rand_seed = 1;
     unsigned long max_rand = 1048576;
     uint32_t my_set = LLC_SET;
@@ -47,9 +59,13 @@ void CACHE::llc_initialize_replacement()
 
     for (int i=0; i<NUM_CPUS; i++)
         PSEL[i] = 0;
+
+    checkpoint.add_section(section_name("drrip.rrpv"), rrpv, sizeof(rrpv));
+    checkpoint.add_section(section_name("drrip.PSEL"), PSEL, sizeof(PSEL));
+    checkpoint.add_section(section_name("drrip.bip_counter"), &bip_counter, sizeof(bip_counter));
 }
 
-int is_it_leader(uint32_t cpu, uint32_t set)
+int DRRIP::is_it_leader(uint32_t cpu, uint32_t set)
 {
     uint32_t start = cpu * NUM_POLICY * SDM_SIZE,
              end = start + NUM_POLICY * SDM_SIZE;
@@ -62,7 +78,7 @@ int is_it_leader(uint32_t cpu, uint32_t set)
 }
 
 // called on every cache hit and cache fill
-void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+void DRRIP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
 {
     // do not update replacement state for writebacks
     if (type == WRITEBACK) {
@@ -108,7 +124,7 @@ void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t wa
 }
 
 // find replacement victim
-uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+uint32_t DRRIP::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
 {
     // look for the maxRRPV line
     while (1)
@@ -125,9 +141,3 @@ uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, c
     assert(0);
     return 0;
 }
-
-// use this function to print out your own stats at the end of simulation
-void CACHE::llc_replacement_final_stats()
-{
-
-}
@@ -1,6 +1,6 @@
 #include "cache.h"
+#include "checkpoint.h"
 #include <cstdlib>
-#include <ctime>
 
 #define maxRRPV 3
 #define SHCT_SIZE  16384
@@ -9,8 +9,6 @@
 #define SAMPLER_WAY LLC_WAY
 #define SHCT_MAX 7
 
-uint32_t rrpv[LLC_SET][LLC_WAY];
-
 // sampler structure
 class SAMPLER_class
 {
@@ -36,10 +34,6 @@ class SAMPLER_class
     };
 };
 
-// sampler
-uint32_t rand_sets[SAMPLER_SET];
-SAMPLER_class sampler[SAMPLER_SET][SAMPLER_WAY];
-
 // prediction table structure
 class SHCT_class {
   public:
@@ -49,10 +43,30 @@ class SHCT_class {
         counter = 0;
     };
 };
-SHCT_class SHCT[NUM_CPUS][SHCT_SIZE];
+
+// the prediction tables are per requesting core
+class SHIP : public REPLACEMENT {
+  public:
+    uint32_t rrpv[LLC_SET][LLC_WAY];
+
+    // sampler
+    uint32_t rand_sets[SAMPLER_SET];
+    SAMPLER_class sampler[SAMPLER_SET][SAMPLER_WAY];
+
+    SHCT_class SHCT[NUM_CPUS][SHCT_SIZE];
+
+    void initialize();
+    uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+    void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit);
+
+    uint32_t is_it_sampled(uint32_t set);
+    void update_sampler(uint32_t cpu, uint32_t s_idx, uint64_t address, uint64_t ip, uint8_t type);
+};
+
+REGISTER_REPLACEMENT("ship", SHIP);
 
 // initialize replacement state
-void CACHE::llc_initialize_replacement()
+void SHIP::initialize()
 {
     cout << "Initialize SHIP state" << endl;
 
@@ -70,7 +84,6 @@ void CACHE::llc_initialize_replacement()
     }
 
     // randomly selected sampler sets
-    srand(time(NULL));
     unsigned long rand_seed = 1;
     unsigned long max_rand = 1048576;
     uint32_t my_set = LLC_SET;
@@ -94,10 +107,14 @@ void CACHE::llc_initialize_replacement()
         } while (do_again);
         printf("rand_sets[%d]: %d\n", i, rand_sets[i]);
     }
+
+    checkpoint.add_section(section_name("ship.rrpv"), rrpv, sizeof(rrpv));
+    checkpoint.add_section(section_name("ship.sampler"), sampler, sizeof(sampler));
+    checkpoint.add_section(section_name("ship.SHCT"), SHCT, sizeof(SHCT));
 }
 
 // check if this set is sampled
-uint32_t is_it_sampled(uint32_t set)
+uint32_t SHIP::is_it_sampled(uint32_t set)
 {
     for (int i=0; i<SAMPLER_SET; i++)
         if (rand_sets[i] == set)
@@ -107,7 +124,7 @@ uint32_t is_it_sampled(uint32_t set)
 }
 
 // update sampler
-void update_sampler(uint32_t cpu, uint32_t s_idx, uint64_t address, uint64_t ip, uint8_t type)
+void SHIP::update_sampler(uint32_t cpu, uint32_t s_idx, uint64_t address, uint64_t ip, uint8_t type)
 {
     SAMPLER_class *s_set = sampler[s_idx];
     uint64_t tag = address / (64*LLC_SET); 
@@ -201,7 +218,7 @@ void update_sampler(uint32_t cpu, uint32_t s_idx, uint64_t address, uint64_t ip,
 }
 
 // find replacement victim
-uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+uint32_t SHIP::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
 {
     // look for the maxRRPV line
     while (1)
@@ -220,7 +237,7 @@ uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, c
 }
 
 // called on every cache hit and cache fill
-void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+void SHIP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
 {
     string TYPE_NAME;
     if (type == LOAD)
@@ -275,9 +292,3 @@ void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t wa
             rrpv[set][way] = maxRRPV;
     }
 }
-
-// use this function to print out your own stats at the end of simulation
-void CACHE::llc_replacement_final_stats()
-{
-
-}
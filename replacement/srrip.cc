@@ -1,10 +1,21 @@
 #include "cache.h"
+#include "checkpoint.h"
 
 #define maxRRPV 3
-uint32_t rrpv[LLC_SET][LLC_WAY];
+
+class SRRIP : public REPLACEMENT {
+  public:
+    uint32_t rrpv[LLC_SET][LLC_WAY];
+
+    void initialize();
+    uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+    void update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit);
+};
+
+REGISTER_REPLACEMENT("srrip", SRRIP);
 
 // initialize replacement state
-void CACHE::llc_initialize_replacement()
+void SRRIP::initialize()
 {
     cout << "Initialize SRRIP state" << endl;
 
@@ -13,10 +24,12 @@ void CACHE::llc_initialize_replacement()
             rrpv[i][j] = maxRRPV;
         }
     }
+
+    checkpoint.add_section(section_name("srrip.rrpv"), rrpv, sizeof(rrpv));
 }
 
 // find replacement victim
-uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+uint32_t SRRIP::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
 {
     // look for the maxRRPV line
     while (1)
@@ -35,7 +48,7 @@ uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, c
 }
 
 // called on every cache hit and cache fill
-void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+void SRRIP::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
 {
     string TYPE_NAME;
     if (type == LOAD)
@@ -66,9 +79,3 @@ void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t wa
     else
         rrpv[set][way] = maxRRPV-1;
 }
-
-// use this function to print out your own stats at the end of simulation
-void CACHE::llc_replacement_final_stats()
-{
-
-}
@@ -0,0 +1,423 @@
+// Reads a trace once and reports what it looks like to the memory system, without simulating it:
+// cache line and page footprint (and how fast it grows), LRU stack distance histograms at 64B and 4KB,
+// per-IP address deltas, branches and memory operations per instruction
+//
+// build: g++ -O2 -std=c++11 -Iinc scripts/characterize_trace.cc src/trace_reader.cc -llzma -lz -lrt -pthread -o bin/characterize_trace
+// usage: bin/characterize_trace [-cloudsuite] [-skip N] [-instructions N] trace
+//
+// the trace is decoded on one thread and every batch goes to three analysis threads (64B stack distances,
+// 4KB stack distances, per-IP statistics), so each analysis sees the whole trace in order
+
+#include "champsim.h"
+#include "instruction.h"
+#include "trace_reader.h"
+#include <unordered_map>
+#include <algorithm>
+
+#define BATCH_SIZE 65536
+#define BATCH_QUEUE_SIZE 4
+#define DISTANCE_BUCKETS 48
+#define DELTA_BUCKETS 16 // deltas of 0 to DELTA_BUCKETS-1 lines get their own bucket
+#define TOP_IPS 10
+
+// one trace record, whatever its format
+class TRACE_RECORD {
+  public:
+    uint64_t ip;
+    uint8_t is_branch, branch_taken, num_loads, num_stores;
+    uint64_t load[NUM_INSTR_SOURCES], store[NUM_INSTR_DESTINATIONS_SPARC];
+};
+
+typedef shared_ptr<vector<TRACE_RECORD> > BATCH;
+
+// hands every batch to one analysis thread, an empty batch ends the trace
+class BATCH_QUEUE {
+  public:
+    mutex lock;
+    condition_variable changed;
+    deque <BATCH> batch;
+
+    void push(BATCH b) {
+        unique_lock<mutex> guard(lock);
+        while (batch.size() == BATCH_QUEUE_SIZE)
+            changed.wait(guard);
+        batch.push_back(b);
+        changed.notify_all();
+    }
+
+    BATCH pop() {
+        unique_lock<mutex> guard(lock);
+        while (batch.size() == 0)
+            changed.wait(guard);
+        BATCH b = batch.front();
+        batch.pop_front();
+        changed.notify_all();
+        return b;
+    }
+};
+
+// bucket 0 is distance 0, bucket b > 0 is [2^(b-1), 2^b)
+static uint32_t log2_bucket(uint64_t value)
+{
+    uint32_t bucket = 0;
+    while (value) {
+        bucket++;
+        value >>= 1;
+    }
+    return (bucket < DISTANCE_BUCKETS) ? bucket : (DISTANCE_BUCKETS - 1);
+}
+
+// LRU stack distance: the number of other blocks touched since the last access to this one.
+// a Fenwick tree over time holds a 1 at each block's last access, the distance is the count of 1s after it;
+// when the tree is full the last accesses are renumbered 0..blocks-1
+class STACK_DISTANCE {
+  public:
+    uint32_t shift;
+    unordered_map <uint64_t, uint64_t> last_access;
+    vector <int32_t> tree;
+    uint64_t now, num_accesses, cold, histogram[DISTANCE_BUCKETS];
+
+    // footprint after 1M, 2M, 4M... instructions
+    vector <pair<uint64_t, uint64_t> > growth;
+    uint64_t next_growth;
+
+    STACK_DISTANCE(uint32_t block_shift) : shift(block_shift), tree(1 << 20) {
+        now = 0;
+        num_accesses = 0;
+        cold = 0;
+        next_growth = 1000000;
+        for (uint32_t b=0; b<DISTANCE_BUCKETS; b++)
+            histogram[b] = 0;
+    }
+
+    void add(uint64_t position, int32_t value) {
+        for (uint64_t i=position+1; i<=tree.size(); i+=(i & -i))
+            tree[i-1] += value;
+    }
+
+    uint64_t prefix(uint64_t position) { // sum over [0, position]
+        uint64_t sum = 0;
+        for (uint64_t i=position+1; i>0; i-=(i & -i))
+            sum += tree[i-1];
+        return sum;
+    }
+
+    void compact() {
+        vector <pair<uint64_t, uint64_t> > order; // last access, block
+        for (unordered_map<uint64_t, uint64_t>::iterator it=last_access.begin(); it!=last_access.end(); it++)
+            order.push_back(make_pair(it->second, it->first));
+        sort(order.begin(), order.end());
+
+        uint64_t size = tree.size();
+        while (size < (2 * order.size()))
+            size *= 2;
+        tree.assign(size, 0);
+        for (uint64_t i=0; i<order.size(); i++)
+            last_access[order[i].second] = i;
+
+        // build the tree in one pass: each node adds itself to its parent once its own children are in
+        for (uint64_t i=0; i<size; i++) {
+            if (i < order.size())
+                tree[i] += 1;
+            uint64_t parent = (i+1) + ((i+1) & -(i+1));
+            if (parent <= size)
+                tree[parent-1] += tree[i];
+        }
+        now = order.size();
+    }
+
+    void access(uint64_t address) {
+        if (now == tree.size())
+            compact();
+
+        uint64_t block = address >> shift;
+        unordered_map<uint64_t, uint64_t>::iterator it = last_access.find(block);
+        if (it == last_access.end()) {
+            cold++;
+            last_access[block] = now;
+        }
+        else {
+            histogram[log2_bucket(prefix(now) - prefix(it->second))]++;
+            add(it->second, -1);
+            it->second = now;
+        }
+        add(now, 1);
+        now++;
+        num_accesses++;
+    }
+
+    void instructions_done(uint64_t num_instr) {
+        if (num_instr == next_growth) {
+            growth.push_back(make_pair(num_instr, last_access.size()));
+            next_growth *= 2;
+        }
+    }
+
+    void print(string name, string unit) {
+        cout << endl << name << " footprint: " << last_access.size() << " " << unit << "s, " << num_accesses << " accesses" << endl;
+        for (uint32_t i=0; i<growth.size(); i++)
+            cout << "  after " << setw(12) << growth[i].first << " instructions: " << growth[i].second << " " << unit << "s" << endl;
+
+        cout << name << " LRU stack distance (" << unit << "s)      accesses   cumulative" << endl;
+        uint64_t total = num_accesses ? num_accesses : 1, cumulative = 0;
+        for (uint32_t b=0; b<DISTANCE_BUCKETS; b++) {
+            if (histogram[b] == 0)
+                continue;
+            cumulative += histogram[b];
+            uint64_t low = b ? (1ull << (b-1)) : 0, high = b ? ((1ull << b) - 1) : 0;
+            cout << "  " << setw(12) << low << " - " << setw(12) << high << " " << setw(12) << histogram[b]
+                 << "   " << fixed << setprecision(2) << setw(6) << (100.0 * cumulative / total) << "%" << endl;
+        }
+        cout << "  " << setw(27) << "cold" << " " << setw(12) << cold << "   " << setw(6) << 100.0 << "%" << endl;
+    }
+};
+
+// per-IP deltas between consecutive data accesses of the same instruction, in cache lines
+class IP_STATE {
+  public:
+    uint64_t last_line, accesses, same_delta;
+    int64_t last_delta, common_delta; // common_delta: majority vote over the deltas
+    uint64_t common_votes;
+
+    IP_STATE() {
+        last_line = 0;
+        accesses = 0;
+        same_delta = 0;
+        last_delta = 0;
+        common_delta = 0;
+        common_votes = 0;
+    }
+};
+
+class IP_STATS {
+  public:
+    unordered_map <uint64_t, IP_STATE> ip;
+    unordered_map <uint64_t, uint64_t> instruction_lines;
+    uint64_t num_instr, num_branch, num_taken, num_loads, num_stores, num_deltas, num_same_delta,
+             delta_histogram[2][DELTA_BUCKETS + DISTANCE_BUCKETS]; // [negative][bucket]
+
+    IP_STATS() {
+        num_instr = 0;
+        num_branch = 0;
+        num_taken = 0;
+        num_loads = 0;
+        num_stores = 0;
+        num_deltas = 0;
+        num_same_delta = 0;
+        memset(delta_histogram, 0, sizeof(delta_histogram));
+    }
+
+    void data_access(uint64_t instr_ip, uint64_t address) {
+        IP_STATE &state = ip[instr_ip];
+        uint64_t line = address >> LOG2_BLOCK_SIZE;
+
+        if (state.accesses) {
+            int64_t delta = line - state.last_line;
+            uint64_t magnitude = (delta < 0) ? -delta : delta;
+            uint32_t bucket = (magnitude < DELTA_BUCKETS) ? magnitude : (DELTA_BUCKETS - 1 + log2_bucket(magnitude >> 4));
+            delta_histogram[delta < 0][bucket]++;
+            num_deltas++;
+
+            if ((state.accesses > 1) && (delta == state.last_delta)) {
+                state.same_delta++;
+                num_same_delta++;
+            }
+
+            if (state.common_votes == 0) {
+                state.common_delta = delta;
+                state.common_votes = 1;
+            }
+            else if (state.common_delta == delta)
+                state.common_votes++;
+            else
+                state.common_votes--;
+
+            state.last_delta = delta;
+        }
+
+        state.last_line = line;
+        state.accesses++;
+    }
+
+    void record(TRACE_RECORD &r) {
+        num_instr++;
+        instruction_lines[r.ip >> LOG2_BLOCK_SIZE]++;
+        if (r.is_branch) {
+            num_branch++;
+            num_taken += r.branch_taken;
+        }
+        num_loads += r.num_loads;
+        num_stores += r.num_stores;
+        for (uint32_t i=0; i<r.num_loads; i++)
+            data_access(r.ip, r.load[i]);
+        for (uint32_t i=0; i<r.num_stores; i++)
+            data_access(r.ip, r.store[i]);
+    }
+
+    void print() {
+        double instr = num_instr ? num_instr : 1;
+        cout << "Instructions: " << num_instr << endl;
+        cout << "Branches: " << num_branch << " (" << fixed << setprecision(2) << (100.0 * num_branch / instr) << "% of instructions, "
+             << (num_branch ? (100.0 * num_taken / num_branch) : 0) << "% taken)" << endl;
+        cout << "Loads: " << num_loads << " (" << (1000.0 * num_loads / instr) << " per kilo-instruction)" << endl;
+        cout << "Stores: " << num_stores << " (" << (1000.0 * num_stores / instr) << " per kilo-instruction)" << endl;
+        cout << "Instruction footprint: " << instruction_lines.size() << " lines, " << ip.size() << " IPs with data accesses" << endl;
+
+        cout << endl << "Per-IP line deltas: " << num_deltas << ", " << (num_deltas ? (100.0 * num_same_delta / num_deltas) : 0)
+             << "% repeat the IP's previous delta" << endl;
+        cout << "  delta              negative     positive" << endl;
+        for (uint32_t b=0; b<(DELTA_BUCKETS + DISTANCE_BUCKETS); b++) {
+            if ((delta_histogram[0][b] + delta_histogram[1][b]) == 0)
+                continue;
+            if (b < (DELTA_BUCKETS - 1))
+                cout << "  " << setw(16) << b;
+            else {
+                uint64_t bucket = b - (DELTA_BUCKETS - 1), low = bucket ? ((1ull << (bucket-1)) << 4) : 0;
+                cout << "  " << setw(7) << ((low > DELTA_BUCKETS - 1) ? low : (DELTA_BUCKETS - 1)) << " - " << setw(6) << (((1ull << bucket) << 4) - 1);
+            }
+            cout << " " << setw(12) << delta_histogram[1][b] << " " << setw(12) << delta_histogram[0][b] << endl;
+        }
+
+        vector <pair<uint64_t, uint64_t> > busiest; // accesses, ip
+        for (unordered_map<uint64_t, IP_STATE>::iterator it=ip.begin(); it!=ip.end(); it++)
+            busiest.push_back(make_pair(it->second.accesses, it->first));
+        sort(busiest.rbegin(), busiest.rend());
+
+        cout << endl << "Busiest IPs                 accesses   common delta   repeated delta" << endl;
+        for (uint32_t i=0; (i<TOP_IPS) && (i<busiest.size()); i++) {
+            IP_STATE &state = ip[busiest[i].second];
+            cout << "  " << hex << setw(16) << busiest[i].second << dec << " " << setw(12) << state.accesses << "   "
+                 << setw(12) << state.common_delta << "   " << setw(13) << (100.0 * state.same_delta / state.accesses) << "%" << endl;
+        }
+    }
+};
+
+int main(int argc, char **argv)
+{
+    int cloudsuite = 0, i = 1;
+    uint64_t skip = 0, max_instr = UINT64_MAX;
+
+    for (; (i < argc) && (argv[i][0] == '-'); i++) {
+        if (strcmp(argv[i], "-cloudsuite") == 0)
+            cloudsuite = 1;
+        else if ((strcmp(argv[i], "-skip") == 0) && ((i+1) < argc))
+            skip = strtoull(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "-instructions") == 0) && ((i+1) < argc))
+            max_instr = strtoull(argv[++i], NULL, 10);
+        else
+            break;
+    }
+    if ((argc - i) != 1) {
+        cerr << "usage: " << argv[0] << " [-cloudsuite] [-skip N] [-instructions N] trace" << endl;
+        return 1;
+    }
+
+    TRACE_READER *trace = open_trace(argv[i]);
+    size_t instr_size = cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+    if (trace->skip(skip * instr_size) < (skip * instr_size)) {
+        cerr << "the trace has fewer than " << skip << " records" << endl;
+        return 1;
+    }
+
+    STACK_DISTANCE lines(LOG2_BLOCK_SIZE), pages(LOG2_PAGE_SIZE);
+    IP_STATS ip_stats;
+    BATCH_QUEUE queue[3];
+
+    // the stack distance threads count every data access, loads first as in the LSQ
+    thread line_thread([&]() {
+        uint64_t num_instr = 0;
+        for (BATCH b = queue[0].pop(); b->size(); b = queue[0].pop()) {
+            for (uint32_t n=0; n<b->size(); n++) {
+                TRACE_RECORD &r = (*b)[n];
+                for (uint32_t j=0; j<r.num_loads; j++)
+                    lines.access(r.load[j]);
+                for (uint32_t j=0; j<r.num_stores; j++)
+                    lines.access(r.store[j]);
+                lines.instructions_done(++num_instr);
+            }
+        }
+    });
+    thread page_thread([&]() {
+        uint64_t num_instr = 0;
+        for (BATCH b = queue[1].pop(); b->size(); b = queue[1].pop()) {
+            for (uint32_t n=0; n<b->size(); n++) {
+                TRACE_RECORD &r = (*b)[n];
+                for (uint32_t j=0; j<r.num_loads; j++)
+                    pages.access(r.load[j]);
+                for (uint32_t j=0; j<r.num_stores; j++)
+                    pages.access(r.store[j]);
+                pages.instructions_done(++num_instr);
+            }
+        }
+    });
+    thread ip_thread([&]() {
+        for (BATCH b = queue[2].pop(); b->size(); b = queue[2].pop())
+            for (uint32_t n=0; n<b->size(); n++)
+                ip_stats.record((*b)[n]);
+    });
+
+    vector <uint8_t> raw(BATCH_SIZE * instr_size);
+    uint64_t num_read = 0;
+    while (num_read < max_instr) {
+        uint64_t num_to_read = ((max_instr - num_read) < BATCH_SIZE) ? (max_instr - num_read) : BATCH_SIZE,
+                 count = trace->read(raw.data(), instr_size, num_to_read);
+        if (count == 0)
+            break;
+
+        BATCH b = make_shared<vector<TRACE_RECORD> >(count);
+        for (uint64_t n=0; n<count; n++) {
+            TRACE_RECORD &r = (*b)[n];
+            uint64_t *load, *store;
+            uint32_t num_destinations;
+
+            if (cloudsuite) {
+                cloudsuite_instr *instr = (cloudsuite_instr *)&raw[n*instr_size];
+                r.ip = instr->ip;
+                r.is_branch = instr->is_branch;
+                r.branch_taken = instr->branch_taken;
+                load = instr->source_memory;
+                store = instr->destination_memory;
+                num_destinations = NUM_INSTR_DESTINATIONS_SPARC;
+            }
+            else {
+                input_instr *instr = (input_instr *)&raw[n*instr_size];
+                r.ip = instr->ip;
+                r.is_branch = instr->is_branch;
+                r.branch_taken = instr->branch_taken;
+                load = instr->source_memory;
+                store = instr->destination_memory;
+                num_destinations = NUM_INSTR_DESTINATIONS;
+            }
+
+            r.num_loads = 0;
+            r.num_stores = 0;
+            for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++)
+                if (load[j])
+                    r.load[r.num_loads++] = load[j];
+            for (uint32_t j=0; j<num_destinations; j++)
+                if (store[j])
+                    r.store[r.num_stores++] = store[j];
+        }
+
+        for (uint32_t q=0; q<3; q++)
+            queue[q].push(b);
+        num_read += count;
+    }
+
+    BATCH end = make_shared<vector<TRACE_RECORD> >();
+    for (uint32_t q=0; q<3; q++)
+        queue[q].push(end);
+    line_thread.join();
+    page_thread.join();
+    ip_thread.join();
+    delete trace;
+
+    cout << "Trace: " << argv[i] << endl;
+    if (skip)
+        cout << "Skipped: " << skip << " instructions" << endl;
+    ip_stats.print();
+    lines.print("Cache line", "line");
+    pages.print("Page", "page");
+
+    return 0;
+}
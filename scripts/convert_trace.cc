@@ -0,0 +1,122 @@
+// Converts a .xz or .gz trace into the block format read by BLOCK_TRACE_READER (see inc/trace_reader.h)
+//
+// build: g++ -O2 -std=c++11 -Iinc scripts/convert_trace.cc src/trace_reader.cc -llzma -lz -lrt -pthread -o bin/convert_trace
+// usage: bin/convert_trace [-cloudsuite] [-columnar] [-level N] [-block N] in.champsimtrace.xz out.champsimtrace.blk
+//   -columnar  store each block in columns (see encode_columns), not for cloudsuite traces
+//   -level     zlib level for each block, 0 stores the blocks as they are (default 1)
+//   -block     records per block (default 65536)
+
+#include "champsim.h"
+#include "instruction.h"
+#include "trace_reader.h"
+#include <zlib.h>
+
+static void write_or_die(FILE *file, const void *data, size_t size)
+{
+    if (fwrite(data, 1, size, file) != size) {
+        cerr << "write failed" << endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int cloudsuite = 0, columnar = 0, level = 1;
+    uint64_t records_per_block = 65536;
+    int i = 1;
+
+    for (; (i < argc) && (argv[i][0] == '-'); i++) {
+        if (strcmp(argv[i], "-cloudsuite") == 0)
+            cloudsuite = 1;
+        else if (strcmp(argv[i], "-columnar") == 0)
+            columnar = 1;
+        else if ((strcmp(argv[i], "-level") == 0) && ((i+1) < argc))
+            level = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-block") == 0) && ((i+1) < argc))
+            records_per_block = strtoull(argv[++i], NULL, 10);
+        else
+            break;
+    }
+    if (((argc - i) != 2) || (level < 0) || (level > 9) || (records_per_block == 0) || (cloudsuite && columnar)) {
+        cerr << "usage: " << argv[0] << " [-cloudsuite | -columnar] [-level 0-9] [-block N] in out.blk" << endl;
+        return 1;
+    }
+
+    TRACE_READER *in = open_trace(argv[i]);
+    FILE *out = fopen(argv[i+1], "wb");
+    if (out == NULL) {
+        cerr << "cannot open " << argv[i+1] << endl;
+        return 1;
+    }
+
+    BLOCK_TRACE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BLOCK_TRACE_MAGIC, sizeof(header.magic));
+    header.version = BLOCK_TRACE_VERSION;
+    header.record_size = cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+    header.compression = level ? BLOCK_TRACE_ZLIB : BLOCK_TRACE_STORED;
+    header.encoding = columnar ? BLOCK_TRACE_COLUMNAR : BLOCK_TRACE_RECORDS;
+    header.records_per_block = records_per_block;
+
+    // the header is written again once the counts and the index offset are known
+    write_or_die(out, &header, sizeof(header));
+
+    vector <BLOCK_TRACE_INDEX> index;
+    vector <uint8_t> block(records_per_block * header.record_size), columns, compressed;
+    uint64_t offset = sizeof(header);
+
+    while (1) {
+        uint64_t num_read = in->read(block.data(), header.record_size, records_per_block);
+        if (num_read == 0)
+            break;
+
+        BLOCK_TRACE_INDEX entry;
+        entry.offset = offset;
+        entry.size = 0;
+
+        uint8_t *data = block.data();
+        uint64_t size = num_read * header.record_size;
+        if (columnar) {
+            // the column sizes go out as they are, only the columns are compressed
+            encode_columns((input_instr *)block.data(), num_read, columns);
+            write_or_die(out, columns.data(), NUM_TRACE_COLUMNS * sizeof(uint32_t));
+            entry.size = NUM_TRACE_COLUMNS * sizeof(uint32_t);
+            data = columns.data() + entry.size;
+            size = columns.size() - entry.size;
+        }
+
+        if (level) {
+            uLongf compressed_size = compressBound(size);
+            compressed.resize(compressed_size);
+            if (compress2(compressed.data(), &compressed_size, data, size, level) != Z_OK) {
+                cerr << "zlib failed on block " << index.size() << endl;
+                return 1;
+            }
+            data = compressed.data();
+            size = compressed_size;
+        }
+        write_or_die(out, data, size);
+        entry.size += size;
+
+        index.push_back(entry);
+        offset += entry.size;
+        header.num_records += num_read;
+
+        if (num_read < records_per_block)
+            break;
+    }
+
+    header.num_blocks = index.size();
+    header.index_offset = offset;
+    if (index.size())
+        write_or_die(out, index.data(), index.size() * sizeof(BLOCK_TRACE_INDEX));
+
+    fseek(out, 0, SEEK_SET);
+    write_or_die(out, &header, sizeof(header));
+    fclose(out);
+    delete in;
+
+    cout << header.num_records << " records in " << header.num_blocks << " blocks, " << offset + index.size()*sizeof(BLOCK_TRACE_INDEX) << " bytes" << endl;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Serves traces to simulators run with -trace_server, see TRACE_SERVER in inc/trace_reader.h
+// each trace is decoded once, by this process, however many simulators read it
+//
+// build: g++ -O2 -std=c++11 -Iinc scripts/trace_server.cc src/trace_reader.cc -llzma -lz -lrt -pthread -o bin/trace_server
+// usage: bin/trace_server trace.champsimtrace.xz [trace...]
+//   runs until interrupted, then removes its shared memory
+
+#include "champsim.h"
+#include "trace_reader.h"
+
+volatile uint8_t stop_serving = 0;
+
+static void stop_handler(int signal)
+{
+    stop_serving = 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " trace [trace...]" << endl;
+        return 1;
+    }
+
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = stop_handler;
+    sigemptyset(&stop_action.sa_mask);
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+
+    vector <TRACE_SERVER *> server;
+    for (int i=1; i<argc; i++)
+        server.push_back(new TRACE_SERVER(argv[i]));
+
+    vector <thread> server_thread;
+    for (uint32_t i=0; i<server.size(); i++)
+        server_thread.push_back(thread(&TRACE_SERVER::serve, server[i], &stop_serving));
+
+    for (uint32_t i=0; i<server.size(); i++) {
+        server_thread[i].join();
+        delete server[i];
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "access_stream.h"
+#include "ooo_cpu.h"
+#include <zlib.h>
+
+ACCESS_STREAM_WRITER::ACCESS_STREAM_WRITER(string name, string level_name) : filename(name), level(level_name)
+{
+    num_records = 0;
+    num_bytes = 0;
+    stop = 0;
+
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL) {
+        cerr << "[ACCESS_STREAM] cannot open " << filename << endl;
+        assert(0);
+    }
+
+    ACCESS_STREAM_HEADER header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ACCESS_STREAM_MAGIC, sizeof(header.magic));
+    header.version = ACCESS_STREAM_VERSION;
+    header.record_size = sizeof(ACCESS_RECORD);
+    strncpy(header.level, level.c_str(), sizeof(header.level) - 1);
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        cerr << "[ACCESS_STREAM] cannot write " << filename << endl;
+        assert(0);
+    }
+    num_bytes = sizeof(header);
+
+    writer = thread(&ACCESS_STREAM_WRITER::write, this);
+}
+
+ACCESS_STREAM_WRITER::~ACCESS_STREAM_WRITER()
+{
+    close();
+}
+
+void ACCESS_STREAM_WRITER::submit(vector <ACCESS_RECORD> &block)
+{
+    unique_lock<mutex> guard(lock);
+    while (pending.size() >= ACCESS_STREAM_BLOCKS)
+        not_full.wait(guard);
+
+    pending.push_back(vector<ACCESS_RECORD>());
+    pending.back().swap(block);
+    if (spare.size()) {
+        block.swap(spare.back());
+        spare.pop_back();
+    }
+    else
+        block.reserve(ACCESS_STREAM_BLOCK_RECORDS);
+
+    not_empty.notify_one();
+}
+
+void ACCESS_STREAM_WRITER::close()
+{
+    if (file == NULL)
+        return;
+
+    {
+        lock_guard<mutex> guard(lock);
+        stop = 1;
+        not_empty.notify_one();
+    }
+    writer.join();
+
+    fclose(file);
+    file = NULL;
+}
+
+void ACCESS_STREAM_WRITER::write()
+{
+    vector <ACCESS_RECORD> block;
+    vector <uint8_t> shuffled, compressed;
+
+    while (1) {
+        {
+            unique_lock<mutex> guard(lock);
+            while (pending.empty() && (stop == 0))
+                not_empty.wait(guard);
+            if (pending.empty())
+                return;
+
+            block.swap(pending.front());
+            pending.pop_front();
+            not_full.notify_one();
+        }
+
+        // byte i of every record next to each other, the high bytes of cycles and addresses barely change
+        uint64_t n = block.size();
+        const uint8_t *bytes = (const uint8_t *)block.data();
+        shuffled.resize(n * sizeof(ACCESS_RECORD));
+        for (uint64_t b=0; b<sizeof(ACCESS_RECORD); b++) {
+            uint8_t *plane = &shuffled[b*n];
+            for (uint64_t r=0; r<n; r++)
+                plane[r] = bytes[r*sizeof(ACCESS_RECORD) + b];
+        }
+
+        uLongf compressed_size = compressBound(shuffled.size());
+        compressed.resize(compressed_size);
+        if (compress2(compressed.data(), &compressed_size, shuffled.data(), shuffled.size(), Z_BEST_SPEED) != Z_OK) {
+            cerr << "[ACCESS_STREAM] zlib failed on " << filename << endl;
+            assert(0);
+        }
+
+        ACCESS_STREAM_BLOCK_HEADER header;
+        header.num_records = n;
+        header.compressed_size = compressed_size;
+        if ((fwrite(&header, sizeof(header), 1, file) != 1) || (fwrite(compressed.data(), 1, compressed_size, file) != compressed_size)) {
+            cerr << "[ACCESS_STREAM] cannot write " << filename << endl;
+            assert(0);
+        }
+        num_records += n;
+        num_bytes += sizeof(header) + compressed_size;
+
+        block.clear();
+        lock_guard<mutex> guard(lock);
+        spare.push_back(vector<ACCESS_RECORD>());
+        spare.back().swap(block);
+    }
+}
+
+void ACCESS_STREAM::record(PACKET *packet, uint8_t hit)
+{
+    ACCESS_RECORD entry;
+    entry.cycle = current_core_cycle[packet->cpu];
+    entry.instr = ooo_cpu[packet->cpu].num_retired;
+    entry.ip = packet->ip;
+    entry.full_addr = packet->full_addr;
+    entry.cpu = packet->cpu;
+    entry.type = packet->type;
+    entry.hit = hit;
+    entry.pf_origin_level = (packet->type == PREFETCH) ? packet->pf_origin_level : 0;
+    entry.fill_level = packet->fill_level;
+    block.push_back(entry);
+
+    if (block.size() == ACCESS_STREAM_BLOCK_RECORDS)
+        writer->submit(block);
+}
+
+void ACCESS_STREAM::flush()
+{
+    if (block.size())
+        writer->submit(block);
+}
+
+ACCESS_STREAM_READER::ACCESS_STREAM_READER(string name) : filename(name), pos(0)
+{
+    file = fopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        cerr << "[ACCESS_STREAM] cannot open " << filename << endl;
+        assert(0);
+    }
+
+    ACCESS_STREAM_HEADER header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || memcmp(header.magic, ACCESS_STREAM_MAGIC, sizeof(header.magic))
+        || (header.version != ACCESS_STREAM_VERSION) || (header.record_size != sizeof(ACCESS_RECORD))) {
+        cerr << "[ACCESS_STREAM] " << filename << " is not a version " << ACCESS_STREAM_VERSION << " access stream" << endl;
+        assert(0);
+    }
+    header.level[sizeof(header.level) - 1] = 0;
+    level = header.level;
+}
+
+ACCESS_STREAM_READER::~ACCESS_STREAM_READER()
+{
+    fclose(file);
+}
+
+int ACCESS_STREAM_READER::next(ACCESS_RECORD &record)
+{
+    if (pos == block.size()) {
+        ACCESS_STREAM_BLOCK_HEADER header;
+        if (fread(&header, sizeof(header), 1, file) != 1)
+            return 0;
+
+        compressed.resize(header.compressed_size);
+        shuffled.resize(header.num_records * sizeof(ACCESS_RECORD));
+        uLongf size = shuffled.size();
+        if ((fread(compressed.data(), 1, header.compressed_size, file) != header.compressed_size)
+            || (uncompress(shuffled.data(), &size, compressed.data(), header.compressed_size) != Z_OK) || (size != shuffled.size())) {
+            cerr << "[ACCESS_STREAM] " << filename << " is truncated or corrupt" << endl;
+            assert(0);
+        }
+
+        uint64_t n = header.num_records;
+        block.resize(n);
+        uint8_t *bytes = (uint8_t *)block.data();
+        for (uint64_t b=0; b<sizeof(ACCESS_RECORD); b++) {
+            const uint8_t *plane = &shuffled[b*n];
+            for (uint64_t r=0; r<n; r++)
+                bytes[r*sizeof(ACCESS_RECORD) + b] = plane[r];
+        }
+        pos = 0;
+
+        if (n == 0)
+            return 0;
+    }
+
+    record = block[pos++];
+    return 1;
+}
@@ -1,4 +1,5 @@
 #include "cache.h"
+#include "uncore.h"
 #include "set.h"
 
 uint64_t l2pf_access = 0;
@@ -226,6 +227,8 @@ void CACHE::handle_writeback()
 
             HIT[WQ.entry[index].type]++;
             ACCESS[WQ.entry[index].type]++;
+            if (stream)
+                stream->record(&WQ.entry[index], 1);
 
             // remove this entry from WQ
             WQ.remove_queue(&WQ.entry[index]);
@@ -312,6 +315,8 @@ void CACHE::handle_writeback()
 
                     MISS[WQ.entry[index].type]++;
                     ACCESS[WQ.entry[index].type]++;
+                    if (stream)
+                        stream->record(&WQ.entry[index], 0);
 
                     // remove this entry from WQ
                     WQ.remove_queue(&WQ.entry[index]);
@@ -420,6 +425,8 @@ void CACHE::handle_writeback()
 
                     MISS[WQ.entry[index].type]++;
                     ACCESS[WQ.entry[index].type]++;
+                    if (stream)
+                        stream->record(&WQ.entry[index], 0);
 
                     // remove this entry from WQ
                     WQ.remove_queue(&WQ.entry[index]);
@@ -514,6 +521,8 @@ void CACHE::handle_read()
 
                 HIT[RQ.entry[index].type]++;
                 ACCESS[RQ.entry[index].type]++;
+                if (stream)
+                    stream->record(&RQ.entry[index], 1);
                 
                 // remove this entry from RQ
                 RQ.remove_queue(&RQ.entry[index]);
@@ -560,12 +569,17 @@ void CACHE::handle_read()
                         if (cache_type == IS_STLB) {
 			  // TODO: need to differentiate page table walk and actual swap
 			  
-			  // emulate page table walk
-			  uint64_t pa = va_to_pa(read_cpu, RQ.entry[index].instr_id, RQ.entry[index].full_addr, RQ.entry[index].address);
-			  
-			  RQ.entry[index].data = pa >> LOG2_PAGE_SIZE; 
-			  RQ.entry[index].event_cycle = current_core_cycle[read_cpu];
-			  return_data(&RQ.entry[index]);
+			  // the page table is shared, so threaded cores leave the walk to the main thread
+			  if (knob_threaded)
+			    uncore.port[read_cpu].add_walk(&RQ.entry[index]);
+			  else {
+			    // emulate page table walk
+			    uint64_t pa = va_to_pa(read_cpu, RQ.entry[index].instr_id, RQ.entry[index].full_addr, RQ.entry[index].address);
+
+			    RQ.entry[index].data = pa >> LOG2_PAGE_SIZE; 
+			    RQ.entry[index].event_cycle = current_core_cycle[read_cpu];
+			    return_data(&RQ.entry[index]);
+			  }
                         }
 		      }
 		    }
@@ -677,6 +691,8 @@ void CACHE::handle_read()
 
                     MISS[RQ.entry[index].type]++;
                     ACCESS[RQ.entry[index].type]++;
+                    if (stream)
+                        stream->record(&RQ.entry[index], 0);
 
                     // remove this entry from RQ
                     RQ.remove_queue(&RQ.entry[index]);
@@ -743,6 +759,8 @@ void CACHE::handle_prefetch()
 
                 HIT[PQ.entry[index].type]++;
                 ACCESS[PQ.entry[index].type]++;
+                if (stream)
+                    stream->record(&PQ.entry[index], 1);
                 
                 // remove this entry from PQ
                 PQ.remove_queue(&PQ.entry[index]);
@@ -856,6 +874,8 @@ void CACHE::handle_prefetch()
 
                     MISS[PQ.entry[index].type]++;
                     ACCESS[PQ.entry[index].type]++;
+                    if (stream)
+                        stream->record(&PQ.entry[index], 0);
 
                     // remove this entry from PQ
                     PQ.remove_queue(&PQ.entry[index]);
@@ -877,13 +897,45 @@ void CACHE::operate()
 
 uint32_t CACHE::get_set(uint64_t address)
 {
-    return (uint32_t) (address & ((1 << lg2(NUM_SET)) - 1)); 
+    return (uint32_t) (address & SET_MASK); 
 }
 
 uint32_t CACHE::get_way(uint64_t address, uint32_t set)
 {
+    return find_way(set, address);
+}
+
+// tag lookup with the number of ways known at compile time, so that the loop unrolls
+template <uint32_t WAYS>
+static inline uint32_t find_way_in(const BLOCK *set_block, uint64_t tag)
+{
+    for (uint32_t way=0; way<WAYS; way++) {
+        if (set_block[way].valid && (set_block[way].tag == tag)) 
+            return way;
+    }
+
+    return WAYS;
+}
+
+// returns NUM_WAY on a miss
+// the associativities of cache.h get their own unrolled lookup, other ones take the generic loop
+uint32_t CACHE::find_way(uint32_t set, uint64_t tag)
+{
+    const BLOCK *set_block = block[set];
+
+    switch (NUM_WAY) {
+        case 4:
+            return find_way_in<4>(set_block, tag);
+        case 8:
+            return find_way_in<8>(set_block, tag);
+        case 12:
+            return find_way_in<12>(set_block, tag);
+        case 16:
+            return find_way_in<16>(set_block, tag);
+    }
+
     for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == address)) 
+        if (set_block[way].valid && (set_block[way].tag == tag)) 
             return way;
     }
 
@@ -951,19 +1003,16 @@ int CACHE::check_hit(PACKET *packet)
     }
 
     // hit
-    for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == packet->address)) {
+    uint32_t way = find_way(set, packet->address);
+    if (way < NUM_WAY) {
 
-            match_way = way;
+        match_way = way;
 
-            DP ( if (warmup_complete[packet->cpu]) {
-            cout << "[" << NAME << "] " << __func__ << " instr_id: " << packet->instr_id << " type: " << +packet->type << hex << " addr: " << packet->address;
-            cout << " full_addr: " << packet->full_addr << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
-            cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru;
-            cout << " event: " << packet->event_cycle << " cycle: " << current_core_cycle[cpu] << endl; });
-
-            break;
-        }
+        DP ( if (warmup_complete[packet->cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " instr_id: " << packet->instr_id << " type: " << +packet->type << hex << " addr: " << packet->address;
+        cout << " full_addr: " << packet->full_addr << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
+        cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru;
+        cout << " event: " << packet->event_cycle << " cycle: " << current_core_cycle[cpu] << endl; });
     }
 
     return match_way;
@@ -981,20 +1030,17 @@ int CACHE::invalidate_entry(uint64_t inval_addr)
     }
 
     // invalidate
-    for (uint32_t way=0; way<NUM_WAY; way++) {
-        if (block[set][way].valid && (block[set][way].tag == inval_addr)) {
+    uint32_t way = find_way(set, inval_addr);
+    if (way < NUM_WAY) {
 
-            block[set][way].valid = 0;
+        block[set][way].valid = 0;
 
-            match_way = way;
+        match_way = way;
 
-            DP ( if (warmup_complete[cpu]) {
-            cout << "[" << NAME << "] " << __func__ << " inval_addr: " << hex << inval_addr;  
-            cout << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
-            cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru << " cycle: " << current_core_cycle[cpu] << endl; });
-
-            break;
-        }
+        DP ( if (warmup_complete[cpu]) {
+        cout << "[" << NAME << "] " << __func__ << " inval_addr: " << hex << inval_addr;  
+        cout << " tag: " << block[set][way].tag << " data: " << block[set][way].data << dec;
+        cout << " set: " << set << " way: " << way << " lru: " << block[set][way].lru << " cycle: " << current_core_cycle[cpu] << endl; });
     }
 
     return match_way;
@@ -1488,3 +1534,181 @@ void CACHE::increment_WQ_FULL(uint64_t address)
 {
     WQ.FULL++;
 }
+
+void CACHE::warm_access(PACKET *packet)
+{
+    // functional counterpart of handle_read/handle_writeback/handle_prefetch and handle_fill used by -functional_warmup:
+    // the access completes immediately, so there are no queues, MSHRs or stats, only contents, replacement and prefetcher state
+    uint32_t warm_cpu = packet->cpu, set = get_set(packet->address);
+    int way = check_hit(packet);
+
+    if (way >= 0) { // hit
+
+        if ((cache_type == IS_ITLB) || (cache_type == IS_DTLB) || (cache_type == IS_STLB))
+            packet->data = block[set][way].data;
+
+        // update prefetcher on load instruction and on prefetches from higher caches
+        if (packet->type == LOAD) {
+            if (cache_type == IS_L1D)
+                l1d_prefetcher_operate(packet->full_addr, packet->ip, 1, packet->type);
+            else if (cache_type == IS_L2C)
+                l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, packet->ip, 1, packet->type, 0);
+            else if (cache_type == IS_LLC) {
+                cpu = warm_cpu;
+                llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, packet->ip, 1, packet->type, 0);
+                cpu = 0;
+            }
+        }
+        else if ((packet->type == PREFETCH) && (packet->pf_origin_level < fill_level)) {
+            if (cache_type == IS_L1D)
+                l1d_prefetcher_operate(packet->full_addr, packet->ip, 1, PREFETCH);
+            else if (cache_type == IS_L2C)
+                packet->pf_metadata = l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, packet->ip, 1, PREFETCH, packet->pf_metadata);
+            else if (cache_type == IS_LLC) {
+                cpu = warm_cpu;
+                packet->pf_metadata = llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, packet->ip, 1, PREFETCH, packet->pf_metadata);
+                cpu = 0;
+            }
+        }
+
+        // update replacement policy
+        if (cache_type == IS_LLC)
+            llc_update_replacement_state(warm_cpu, set, way, block[set][way].full_addr, packet->ip, 0, packet->type, 1);
+        else
+            update_replacement_state(warm_cpu, set, way, block[set][way].full_addr, packet->ip, 0, packet->type, 1);
+
+        // writebacks (and RFOs in the L1D, which arrive through the WQ) mark the block dirty, reads mark it used
+        if ((packet->type == WRITEBACK) || ((packet->type == RFO) && (cache_type == IS_L1D)))
+            block[set][way].dirty = 1;
+        else if (packet->type != PREFETCH) {
+            if (block[set][way].prefetch) {
+                pf_useful++;
+                block[set][way].prefetch = 0;
+            }
+            block[set][way].used = 1;
+        }
+    }
+    else { // miss
+
+        // a writeback miss fills without reading the lower level
+        if (packet->type != WRITEBACK) {
+
+            if (packet->type == LOAD) {
+                if (cache_type == IS_L1D)
+                    l1d_prefetcher_operate(packet->full_addr, packet->ip, 0, packet->type);
+                else if (cache_type == IS_L2C)
+                    l2c_prefetcher_operate(packet->address<<LOG2_BLOCK_SIZE, packet->ip, 0, packet->type, 0);
+                else if (cache_type == IS_LLC) {
+                    cpu = warm_cpu;
+                    llc_prefetcher_operate(packet->address<<LOG2_BLOCK_SIZE, packet->ip, 0, packet->type, 0);
+                    cpu = 0;
+                }
+            }
+            else if ((packet->type == PREFETCH) && (packet->pf_origin_level < fill_level)) {
+                if (cache_type == IS_L1D)
+                    l1d_prefetcher_operate(packet->full_addr, packet->ip, 0, PREFETCH);
+                else if (cache_type == IS_L2C)
+                    packet->pf_metadata = l2c_prefetcher_operate(packet->address<<LOG2_BLOCK_SIZE, packet->ip, 0, PREFETCH, packet->pf_metadata);
+                else if (cache_type == IS_LLC) {
+                    cpu = warm_cpu;
+                    packet->pf_metadata = llc_prefetcher_operate(packet->address<<LOG2_BLOCK_SIZE, packet->ip, 0, PREFETCH, packet->pf_metadata);
+                    cpu = 0;
+                }
+            }
+
+            if (lower_level) {
+                PACKET miss_packet = *packet;
+                lower_level->warm_access(&miss_packet);
+                packet->data = miss_packet.data;
+            }
+            else if (cache_type == IS_STLB) {
+                // emulate page table walk
+                uint64_t pa = va_to_pa(warm_cpu, packet->instr_id, packet->full_addr, packet->address);
+                packet->data = pa >> LOG2_PAGE_SIZE;
+            }
+        }
+
+        // prefetches for a lower level do not fill this cache
+        if (packet->fill_level <= fill_level) {
+
+            // find victim
+            if (cache_type == IS_LLC)
+                way = llc_find_victim(warm_cpu, packet->instr_id, set, block[set], packet->ip, packet->full_addr, packet->type);
+            else
+                way = find_victim(warm_cpu, packet->instr_id, set, block[set], packet->ip, packet->full_addr, packet->type);
+
+#ifdef LLC_BYPASS
+            if ((cache_type == IS_LLC) && (way == LLC_WAY)) {
+                llc_update_replacement_state(warm_cpu, set, way, packet->full_addr, packet->ip, 0, packet->type, 0);
+                return;
+            }
+#endif
+
+            // the dirty victim goes to the lower level right away
+            if (block[set][way].dirty && lower_level) {
+                PACKET writeback_packet;
+
+                writeback_packet.fill_level = fill_level << 1;
+                writeback_packet.cpu = warm_cpu;
+                writeback_packet.address = block[set][way].address;
+                writeback_packet.full_addr = block[set][way].full_addr;
+                writeback_packet.data = block[set][way].data;
+                writeback_packet.instr_id = packet->instr_id;
+                writeback_packet.ip = 0; // writeback does not have ip
+                writeback_packet.type = WRITEBACK;
+
+                lower_level->warm_access(&writeback_packet);
+            }
+
+            // update prefetcher
+            if (cache_type == IS_L1D)
+                l1d_prefetcher_cache_fill(packet->full_addr, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+            else if (cache_type == IS_L2C)
+                packet->pf_metadata = l2c_prefetcher_cache_fill(packet->address<<LOG2_BLOCK_SIZE, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+            else if (cache_type == IS_LLC) {
+                cpu = warm_cpu;
+                packet->pf_metadata = llc_prefetcher_cache_fill(packet->address<<LOG2_BLOCK_SIZE, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+                cpu = 0;
+            }
+
+            // update replacement policy
+            if (cache_type == IS_LLC)
+                llc_update_replacement_state(warm_cpu, set, way, packet->full_addr, packet->ip, block[set][way].full_addr, packet->type, 0);
+            else
+                update_replacement_state(warm_cpu, set, way, packet->full_addr, packet->ip, block[set][way].full_addr, packet->type, 0);
+
+            fill_cache(set, way, packet);
+
+            if ((packet->type == WRITEBACK) || ((packet->type == RFO) && (cache_type == IS_L1D)))
+                block[set][way].dirty = 1;
+        }
+    }
+
+    // whatever the prefetcher asked for is issued immediately
+    while (PQ.occupancy) {
+        PACKET pf_packet = PQ.entry[PQ.head];
+        PQ.remove_queue(&PQ.entry[PQ.head]);
+        warm_access(&pf_packet);
+    }
+}
+
+uint64_t CACHE::get_next_event_cycle()
+{
+    // earliest cycle at which operate() can change the state of this cache
+    uint64_t next_event = UINT64_MAX;
+
+    if ((MSHR.next_fill_index < MSHR_SIZE) && (MSHR.next_fill_cycle < next_event))
+        next_event = MSHR.next_fill_cycle;
+
+    if (WQ.occupancy && (WQ.entry[WQ.head].event_cycle < next_event))
+        next_event = WQ.entry[WQ.head].event_cycle;
+
+    if (RQ.occupancy && (RQ.entry[RQ.head].event_cycle < next_event))
+        next_event = RQ.entry[RQ.head].event_cycle;
+
+    // prefetches are only handled when the read queue is empty
+    if (PQ.occupancy && (RQ.occupancy == 0) && (PQ.entry[PQ.head].event_cycle < next_event))
+        next_event = PQ.entry[PQ.head].event_cycle;
+
+    return next_event;
+}
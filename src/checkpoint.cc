@@ -0,0 +1,174 @@
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC "CHAMPCKP"
+#define CHECKPOINT_VERSION 1
+
+CHECKPOINT checkpoint;
+
+void CHECKPOINT::add_section(string name, void *data, uint64_t size)
+{
+    for (uint32_t i=0; i<section.size(); i++) {
+        if (section[i].name == name) {
+            cerr << "[CHECKPOINT] section " << name << " is added twice" << endl;
+            assert(0);
+        }
+    }
+
+    CHECKPOINT_SECTION new_section;
+    new_section.name = name;
+    new_section.data = data;
+    new_section.size = size;
+
+    section.push_back(new_section);
+}
+
+void CHECKPOINT::add_section(string name, function<void(vector<uint8_t> &)> save, function<void(const vector<uint8_t> &)> load)
+{
+    add_section(name, NULL, 0);
+    section.back().save = save;
+    section.back().load = load;
+}
+
+// checkpoints ending in .gz or .xz are piped through gzip/xz, the same way traces are read
+FILE *open_checkpoint(string filename, const char *mode, uint8_t &piped)
+{
+    string command;
+    uint8_t write = (mode[0] == 'w');
+
+    if ((filename.size() > 3) && (filename.compare(filename.size()-3, 3, ".gz") == 0))
+        command = write ? ("gzip -c > " + filename) : ("gunzip -c " + filename);
+    else if ((filename.size() > 3) && (filename.compare(filename.size()-3, 3, ".xz") == 0))
+        command = write ? ("xz -c > " + filename) : ("xz -dc " + filename);
+
+    FILE *file;
+    if (command.size()) {
+        piped = 1;
+        file = popen(command.c_str(), mode);
+    }
+    else {
+        piped = 0;
+        file = fopen(filename.c_str(), mode);
+    }
+
+    if (file == NULL) {
+        cerr << "[CHECKPOINT] cannot open " << filename << endl;
+        assert(0);
+    }
+
+    return file;
+}
+
+void CHECKPOINT::save(string filename)
+{
+    uint8_t piped;
+    FILE *file = open_checkpoint(filename, "w", piped);
+
+    uint32_t version = CHECKPOINT_VERSION, num_cpus = NUM_CPUS, num_section = section.size();
+    fwrite(CHECKPOINT_MAGIC, 1, 8, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(&num_cpus, sizeof(num_cpus), 1, file);
+    fwrite(&num_section, sizeof(num_section), 1, file);
+
+    uint64_t total_size = 0;
+    vector <uint8_t> buffer;
+    for (uint32_t i=0; i<section.size(); i++) {
+        uint32_t name_size = section[i].name.size();
+        const void *data = section[i].data;
+        uint64_t size = section[i].size;
+
+        if (data == NULL) {
+            buffer.clear();
+            section[i].save(buffer);
+            data = buffer.data();
+            size = buffer.size();
+        }
+
+        fwrite(&name_size, sizeof(name_size), 1, file);
+        fwrite(section[i].name.data(), 1, name_size, file);
+        fwrite(&size, sizeof(size), 1, file);
+        if (fwrite(data, 1, size, file) != size) {
+            cerr << "[CHECKPOINT] cannot write " << section[i].name << " to " << filename << endl;
+            assert(0);
+        }
+
+        total_size += size;
+    }
+
+    if (piped)
+        pclose(file);
+    else
+        fclose(file);
+
+    cout << "Saved checkpoint " << filename << " (" << section.size() << " sections, " << total_size << " bytes)" << endl;
+}
+
+void CHECKPOINT::load(string filename)
+{
+    uint8_t piped;
+    FILE *file = open_checkpoint(filename, "r", piped);
+
+    char magic[8];
+    uint32_t version = 0, num_cpus = 0, num_section = 0;
+    if ((fread(magic, 1, 8, file) != 8) || memcmp(magic, CHECKPOINT_MAGIC, 8) ||
+        !fread(&version, sizeof(version), 1, file) || !fread(&num_cpus, sizeof(num_cpus), 1, file) || !fread(&num_section, sizeof(num_section), 1, file)) {
+        cerr << "[CHECKPOINT] " << filename << " is not a checkpoint" << endl;
+        assert(0);
+    }
+    if ((version != CHECKPOINT_VERSION) || (num_cpus != NUM_CPUS)) {
+        cerr << "[CHECKPOINT] " << filename << " has version " << version << " and " << num_cpus << " cpus, expected version ";
+        cerr << CHECKPOINT_VERSION << " and " << NUM_CPUS << " cpus" << endl;
+        assert(0);
+    }
+
+    map <string, vector<uint8_t> > saved;
+    for (uint32_t i=0; i<num_section; i++) {
+        uint32_t name_size = 0;
+        uint64_t size = 0;
+        string name;
+
+        if (fread(&name_size, sizeof(name_size), 1, file)) {
+            name.resize(name_size);
+            if ((fread(&name[0], 1, name_size, file) == name_size) && fread(&size, sizeof(size), 1, file)) {
+                vector <uint8_t> &buffer = saved[name];
+                buffer.resize(size);
+                if (fread(buffer.data(), 1, size, file) == size)
+                    continue;
+            }
+        }
+
+        cerr << "[CHECKPOINT] " << filename << " is truncated" << endl;
+        assert(0);
+    }
+
+    if (piped)
+        pclose(file);
+    else
+        fclose(file);
+
+    uint32_t num_restored = 0;
+    for (uint32_t i=0; i<section.size(); i++) {
+        map <string, vector<uint8_t> >::iterator it = saved.find(section[i].name);
+        if (it == saved.end()) {
+            cout << "Checkpoint has no " << section[i].name << ", it starts cold" << endl;
+            continue;
+        }
+
+        if (section[i].data) {
+            if (it->second.size() != section[i].size) {
+                cerr << "[CHECKPOINT] " << section[i].name << " has " << it->second.size() << " bytes, expected " << section[i].size << endl;
+                assert(0);
+            }
+            memcpy(section[i].data, it->second.data(), section[i].size);
+        }
+        else
+            section[i].load(it->second);
+
+        saved.erase(it);
+        num_restored++;
+    }
+
+    for (map <string, vector<uint8_t> >::iterator it = saved.begin(); it != saved.end(); it++)
+        cout << "Checkpoint section " << it->first << " is not used by this binary" << endl;
+
+    cout << "Loaded checkpoint " << filename << " (" << num_restored << " sections)" << endl;
+}
@@ -308,6 +308,8 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
                     queue->ROW_BUFFER_HIT++;
                 else
                     queue->ROW_BUFFER_MISS++;
+                if (stream)
+                    stream->record(&queue->entry[request_index], bank_request[op_channel][op_rank][op_bank].row_buffer_hit);
 
                 // this bank is ready for another DRAM request
                 bank_request[op_channel][op_rank][op_bank].request_index = -1;
@@ -336,6 +338,8 @@ void MEMORY_CONTROLLER::process(PACKET_QUEUE *queue)
                     queue->ROW_BUFFER_HIT++;
                 else
                     queue->ROW_BUFFER_MISS++;
+                if (stream)
+                    stream->record(&queue->entry[request_index], bank_request[op_channel][op_rank][op_bank].row_buffer_hit);
 
                 // this bank is ready for another DRAM request
                 bank_request[op_channel][op_rank][op_bank].request_index = -1;
@@ -701,3 +705,54 @@ void MEMORY_CONTROLLER::increment_WQ_FULL(uint64_t address)
     uint32_t channel = dram_get_channel(address);
     WQ[channel].FULL++;
 }
+
+void MEMORY_CONTROLLER::warm_access(PACKET *packet)
+{
+    // DRAM holds no state worth warming (row buffers are only timing)
+}
+
+uint64_t MEMORY_CONTROLLER::get_next_event_cycle()
+{
+    // earliest cycle at which operate() can change the state of the controller
+    uint64_t next_event = UINT64_MAX;
+
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+
+        // read/write mode switch happens on the very next cycle
+        if ((write_mode[i] == 0) && (WQ[i].occupancy >= DRAM_WRITE_HIGH_WM))
+            return 0;
+        if (write_mode[i] && ((WQ[i].occupancy == 0) || (RQ[i].occupancy && (WQ[i].occupancy < DRAM_WRITE_LOW_WM))))
+            return 0;
+
+        PACKET_QUEUE *queue = write_mode[i] ? &WQ[i] : &RQ[i];
+
+        // schedule() does nothing unless an unscheduled request targets an idle bank
+        if (queue->next_schedule_index < queue->SIZE) {
+            for (uint32_t j=0; j<queue->SIZE; j++) {
+                uint64_t op_addr = queue->entry[j].address;
+                if ((op_addr == 0) || queue->entry[j].scheduled)
+                    continue;
+
+                if (bank_request[dram_get_channel(op_addr)][dram_get_rank(op_addr)][dram_get_bank(op_addr)].working == 0) {
+                    if (queue->next_schedule_cycle < next_event)
+                        next_event = queue->next_schedule_cycle;
+                    break;
+                }
+            }
+        }
+
+        // process() waits for both the request and its bank
+        if (queue->next_process_index < queue->SIZE) {
+            uint64_t op_addr = queue->entry[queue->next_process_index].address,
+                     process_cycle = queue->next_process_cycle,
+                     bank_cycle = bank_request[dram_get_channel(op_addr)][dram_get_rank(op_addr)][dram_get_bank(op_addr)].cycle_available;
+
+            if (bank_cycle > process_cycle)
+                process_cycle = bank_cycle;
+            if (process_cycle < next_event)
+                next_event = process_cycle;
+        }
+    }
+
+    return next_event;
+}
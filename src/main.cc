@@ -3,7 +3,16 @@
 #include <getopt.h>
 #include "ooo_cpu.h"
 #include "uncore.h"
+#include "checkpoint.h"
+#include "prefetcher_replay.h"
+#include "access_stream.h"
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <cmath>
+#include <sys/wait.h>
+#include <atomic>
+#include <vector>
 
 uint8_t warmup_complete[NUM_CPUS], 
         simulation_complete[NUM_CPUS], 
@@ -11,14 +20,97 @@ uint8_t warmup_complete[NUM_CPUS],
         all_simulation_complete = 0,
         MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS,
         knob_cloudsuite = 0,
-        knob_low_bandwidth = 0;
+        knob_low_bandwidth = 0,
+        knob_event_skip = 0,
+        knob_threaded = 0,
+        knob_skip_translate = 0,
+        knob_functional_warmup = 0,
+        knob_memory_only = 0,
+        show_heartbeat = 1,
+        run_simulation = 1;
 
 uint64_t warmup_instructions     = 1000000,
          simulation_instructions = 10000000,
-         champsim_seed;
+         sync_quantum            = 1,
+         skip_instructions       = 0,
+         champsim_seed,
+         libc_rand_draws = 0;
 
 time_t start_time;
 
+string save_checkpoint_file, load_checkpoint_file;
+
+// modules, see module.h
+string branch_name = "bimodal",
+       l1d_pref_name = "no",
+       l2c_pref_name = "no",
+       llc_pref_name = "no",
+       llc_repl_name = "lru";
+
+// SAMPLED SIMULATION
+// every sample_period instructions of the ROI run sample_warm detailed instructions to refill the pipeline,
+// then sample_window measured ones, then drain the pipeline and warm functionally through the rest of the period
+#define SAMPLE_WARM 0
+#define SAMPLE_MEASURE 1
+#define SAMPLE_DRAIN 2
+#define SAMPLE_Z 1.96 // 95% confidence
+
+uint64_t sample_period = 0,
+         sample_window = 10000,
+         sample_warm = 2000;
+
+class SAMPLE_STATE {
+  public:
+    uint8_t phase;
+    uint64_t unit_begin, fast_forwarded,
+             begin_instr, begin_cycle, begin_mispredictions, begin_miss[3];
+
+    // one value per measured window
+    vector <double> cpi, branch_mpki, miss_mpki[3];
+
+    SAMPLE_STATE() {
+        phase = SAMPLE_WARM;
+        unit_begin = 0;
+        fast_forwarded = 0;
+        begin_instr = 0;
+        begin_cycle = 0;
+        begin_mispredictions = 0;
+        for (uint32_t i=0; i<3; i++)
+            begin_miss[i] = 0;
+    };
+};
+
+SAMPLE_STATE sample[NUM_CPUS];
+
+// SIMPOINTS
+// -simpoints FILE simulates several regions of one trace in a single pass, each after its own functional warmup
+class SIMPOINT {
+  public:
+    uint64_t offset, start; // requested and actual first instruction of the region
+    double weight;
+
+    // region statistics, caches in the order L1D, L1I, L2C, LLC
+    uint64_t instr, cycles, branches, mispredictions,
+             access[4][NUM_TYPES], hit[4][NUM_TYPES], miss[4][NUM_TYPES],
+             row_hit, row_miss;
+};
+
+string simpoint_file;
+vector <SIMPOINT> simpoint;
+uint32_t simpoint_next = 0; // next region to warm up
+
+// -prefetcher_replay l1d|l2c: replay the trace's data accesses, or a recorded stream, into one prefetcher, see prefetcher_replay.h
+string prefetcher_replay_level, replay_stream_file;
+
+// -record_stream L1D|L2C|LLC|DRAM: write the accesses of that level to record_stream_file, see access_stream.h
+string record_stream_level, record_stream_file;
+ACCESS_STREAM_WRITER *stream_writer = NULL;
+vector <ACCESS_STREAM *> access_stream;
+
+// -fanout KNOB=v1,v2,...: warm up once, then fork one child per value with that module swapped in
+string fanout_knob, fanout_output = "fanout";
+vector <string> fanout_values;
+
 // PAGE TABLE
 uint32_t PAGE_TABLE_LATENCY = 0, SWAP_LATENCY = 0;
 queue <uint64_t > page_queue;
@@ -95,7 +187,7 @@ void print_branch_stats()
     for (uint32_t i=0; i<NUM_CPUS; i++) {
         cout << endl << "CPU " << i << " Branch Prediction Accuracy: ";
         cout << (100.0*(ooo_cpu[i].num_branch - ooo_cpu[i].branch_mispredictions)) / ooo_cpu[i].num_branch;
-        cout << "% MPKI: " << (1000.0*ooo_cpu[i].branch_mispredictions)/(ooo_cpu[i].num_retired - ooo_cpu[i].warmup_instructions) << endl;
+        cout << "% MPKI: " << (1000.0*ooo_cpu[i].branch_mispredictions)/(ooo_cpu[i].num_retired - ooo_cpu[i].warmup_instructions - sample[i].fast_forwarded) << endl;
     }
 }
 
@@ -146,6 +238,340 @@ void reset_cache_stats(uint32_t cpu, CACHE *cache)
     cache->WQ.FULL = 0;
 }
 
+// swap the module chosen by the fanout knob for the one named value
+// a new module starts cold, the warmup configuration keeps its warm tables
+void fanout_swap(string value)
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if ((fanout_knob == "branch") && (value != branch_name)) {
+            delete ooo_cpu[i].branch_predictor;
+            ooo_cpu[i].branch_predictor = MODULE_REGISTRY<BRANCH_PREDICTOR>::create(value, "branch predictor");
+            ooo_cpu[i].initialize_branch_predictor();
+        }
+        if ((fanout_knob == "l1d_pref") && (value != l1d_pref_name)) {
+            delete ooo_cpu[i].L1D.prefetcher;
+            ooo_cpu[i].L1D.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("l1d." + value, "L1D prefetcher");
+            ooo_cpu[i].L1D.prefetcher_initialize();
+        }
+        if ((fanout_knob == "l2c_pref") && (value != l2c_pref_name)) {
+            delete ooo_cpu[i].L2C.prefetcher;
+            ooo_cpu[i].L2C.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("l2c." + value, "L2C prefetcher");
+            ooo_cpu[i].L2C.prefetcher_initialize();
+        }
+    }
+    if ((fanout_knob == "llc_pref") && (value != llc_pref_name)) {
+        delete uncore.LLC.prefetcher;
+        uncore.LLC.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("llc." + value, "LLC prefetcher");
+        uncore.LLC.prefetcher_initialize();
+    }
+    if ((fanout_knob == "llc_repl") && (value != llc_repl_name)) {
+        delete uncore.LLC.replacement;
+        uncore.LLC.replacement = MODULE_REGISTRY<REPLACEMENT>::create(value, "LLC replacement policy");
+        uncore.LLC.llc_initialize_replacement();
+    }
+
+    if (fanout_knob == "branch")
+        branch_name = value;
+    else if (fanout_knob == "l1d_pref")
+        l1d_pref_name = value;
+    else if (fanout_knob == "l2c_pref")
+        l2c_pref_name = value;
+    else if (fanout_knob == "llc_pref")
+        llc_pref_name = value;
+    else
+        llc_repl_name = value;
+}
+
+// fork one child per fanout value, the children share the warm caches, predictors and page table copy-on-write
+// the parent only waits for them and exits
+void fanout()
+{
+    vector <pid_t> child(fanout_values.size());
+
+    cout.flush();
+    fflush(stdout);
+
+    for (uint32_t n=0; n<fanout_values.size(); n++) {
+        string file_name = fanout_output + "." + fanout_knob + "=" + fanout_values[n] + ".txt";
+
+        child[n] = fork();
+        if (child[n] < 0) {
+            cerr << "[FANOUT] fork failed for " << fanout_knob << "=" << fanout_values[n] << endl;
+            assert(0);
+        }
+
+        if (child[n] == 0) {
+            if (freopen(file_name.c_str(), "w", stdout) == NULL) {
+                cerr << "[FANOUT] cannot open " << file_name << endl;
+                _exit(1);
+            }
+            cout << "Fan-out configuration: " << fanout_knob << "=" << fanout_values[n] << endl;
+
+            // the checkpoint sections describe the warmup configuration, a swapped-in module adds its own
+            checkpoint.section.clear();
+            fanout_swap(fanout_values[n]);
+
+            // the trace decoder threads stay in the parent, open the traces again and read up to the same position
+            // (the parent's readers are left alone, their threads do not exist here, and so are its shared passes;
+            // the records the parent read ahead are read again)
+            for (uint32_t i=0; i<NUM_CPUS; i++) {
+                ooo_cpu[i].decode_pos = ooo_cpu[i].decode_count = 0;
+                ooo_cpu[i].trace_file = open_trace(ooo_cpu[i].trace_string);
+                ooo_cpu[i].skip_trace(ooo_cpu[i].skipped_instructions + ooo_cpu[i].instr_unique_id, 0);
+            }
+            cout << endl;
+            return;
+        }
+
+        cout << "Fan-out " << fanout_knob << "=" << fanout_values[n] << " runs in process " << child[n] << ", stats in " << file_name << endl;
+    }
+
+    // the children read the traces on their own, a trace server must not keep waiting for this process
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        delete ooo_cpu[i].trace_file;
+
+    int failed = 0;
+    for (uint32_t n=0; n<fanout_values.size(); n++) {
+        int status;
+        waitpid(child[n], &status, 0);
+        if (WIFEXITED(status) && (WEXITSTATUS(status) == 0))
+            cout << "Fan-out " << fanout_knob << "=" << fanout_values[n] << " completed" << endl;
+        else {
+            cout << "Fan-out " << fanout_knob << "=" << fanout_values[n] << " FAILED (status " << status << ")" << endl;
+            failed = 1;
+        }
+    }
+
+    exit(failed);
+}
+
+// one "offset weight" pair per line, offsets in instructions from the start of the trace, # starts a comment
+void read_simpoints(string filename)
+{
+    ifstream file(filename.c_str());
+    string line;
+    double total_weight = 0;
+
+    if (!file.good()) {
+        cerr << "[SIMPOINT] cannot open " << filename << endl;
+        assert(0);
+    }
+
+    while (getline(file, line)) {
+        if (line.find('#') != string::npos)
+            line = line.substr(0, line.find('#'));
+
+        SIMPOINT region;
+        stringstream fields(line);
+        if (!(fields >> region.offset))
+            continue;
+        if (!(fields >> region.weight) || (region.weight < 0)) {
+            cerr << "[SIMPOINT] " << filename << ": expected \"offset weight\" in: " << line << endl;
+            assert(0);
+        }
+        simpoint.push_back(region);
+        total_weight += region.weight;
+    }
+
+    if ((simpoint.size() == 0) || (total_weight == 0)) {
+        cerr << "[SIMPOINT] " << filename << " has no weighted regions" << endl;
+        assert(0);
+    }
+
+    // the trace is read once, front to back
+    for (uint32_t i=0; i<simpoint.size(); i++) {
+        for (uint32_t j=i+1; j<simpoint.size(); j++) {
+            if (simpoint[j].offset < simpoint[i].offset)
+                swap(simpoint[i], simpoint[j]);
+        }
+        simpoint[i].weight /= total_weight;
+    }
+}
+
+// keep the statistics of the region that just finished, before the next warmup resets them
+void record_simpoint()
+{
+    SIMPOINT *region = &simpoint[simpoint_next - 1];
+    CACHE *cache[4] = {&ooo_cpu[0].L1D, &ooo_cpu[0].L1I, &ooo_cpu[0].L2C, &uncore.LLC};
+
+    region->instr = ooo_cpu[0].num_retired - ooo_cpu[0].begin_sim_instr;
+    region->cycles = current_core_cycle[0] - ooo_cpu[0].begin_sim_cycle;
+    region->branches = ooo_cpu[0].num_branch;
+    region->mispredictions = ooo_cpu[0].branch_mispredictions;
+    for (uint32_t i=0; i<4; i++) {
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            region->access[i][j] = cache[i]->sim_access[0][j];
+            region->hit[i][j] = cache[i]->sim_hit[0][j];
+            region->miss[i][j] = cache[i]->sim_miss[0][j];
+        }
+    }
+
+    region->row_hit = 0;
+    region->row_miss = 0;
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        region->row_hit += uncore.DRAM.RQ[i].ROW_BUFFER_HIT + uncore.DRAM.WQ[i].ROW_BUFFER_HIT;
+        region->row_miss += uncore.DRAM.RQ[i].ROW_BUFFER_MISS + uncore.DRAM.WQ[i].ROW_BUFFER_MISS;
+    }
+}
+
+// per-region statistics and their weighted combination
+// CPI and per-kilo-instruction rates are combined with the region weights, IPC is the inverse of the weighted CPI
+void print_simpoint_stats()
+{
+    const char *cache_name[4] = {"L1D", "L1I", "L2C", "LLC"};
+    double cpi = 0, branch_mpki = 0, access_pki[4] = {0}, miss_pki[4] = {0}, load_mpki[4] = {0}, row_hit_pki = 0, row_miss_pki = 0;
+
+    cout << endl << "SimPoint Statistics" << endl;
+    for (uint32_t r=0; r<simpoint.size(); r++) {
+        SIMPOINT *region = &simpoint[r];
+        double kilo_instr = region->instr / 1000.0;
+        uint64_t row_total = region->row_hit + region->row_miss;
+
+        cout << endl << "Region " << r << " offset: " << region->offset << " start: " << region->start << " weight: " << region->weight << endl;
+        cout << "Region " << r << " IPC: " << ((double) region->instr / region->cycles) << " instructions: " << region->instr << " cycles: " << region->cycles;
+        cout << " branch MPKI: " << region->mispredictions / kilo_instr << endl;
+
+        cpi += region->weight * region->cycles / region->instr;
+        branch_mpki += region->weight * region->mispredictions / kilo_instr;
+
+        for (uint32_t i=0; i<4; i++) {
+            uint64_t total_access = 0, total_hit = 0, total_miss = 0;
+            for (uint32_t j=0; j<NUM_TYPES; j++) {
+                total_access += region->access[i][j];
+                total_hit += region->hit[i][j];
+                total_miss += region->miss[i][j];
+            }
+
+            cout << "Region " << r << " " << cache_name[i] << " TOTAL ACCESS: " << setw(10) << total_access << "  HIT: " << setw(10) << total_hit << "  MISS: " << setw(10) << total_miss;
+            cout << "  LOAD MPKI: " << region->miss[i][LOAD] / kilo_instr << endl;
+
+            access_pki[i] += region->weight * total_access / kilo_instr;
+            miss_pki[i] += region->weight * total_miss / kilo_instr;
+            load_mpki[i] += region->weight * region->miss[i][LOAD] / kilo_instr;
+        }
+
+        cout << "Region " << r << " DRAM ROW_BUFFER_HIT: " << setw(10) << region->row_hit << "  ROW_BUFFER_MISS: " << setw(10) << region->row_miss;
+        cout << "  HIT RATE: " << (row_total ? ((double) region->row_hit / row_total) : 0) << endl;
+
+        row_hit_pki += region->weight * region->row_hit / kilo_instr;
+        row_miss_pki += region->weight * region->row_miss / kilo_instr;
+    }
+
+    cout << endl << "Weighted IPC: " << 1 / cpi << " CPI: " << cpi << " branch MPKI: " << branch_mpki << endl;
+    for (uint32_t i=0; i<4; i++) {
+        cout << "Weighted " << cache_name[i] << " ACCESS PKI: " << access_pki[i] << "  MISS PKI: " << miss_pki[i];
+        cout << "  LOAD MPKI: " << load_mpki[i] << endl;
+    }
+    cout << "Weighted DRAM ROW_BUFFER_HIT PKI: " << row_hit_pki << "  ROW_BUFFER_MISS PKI: " << row_miss_pki;
+    cout << "  HIT RATE: " << (row_hit_pki / (row_hit_pki + row_miss_pki)) << endl;
+}
+
+// demand load misses of the L1D, L2C and LLC, the caches reported per window
+void sample_misses(uint32_t cpu, uint64_t *miss)
+{
+    miss[0] = ooo_cpu[cpu].L1D.sim_miss[cpu][LOAD];
+    miss[1] = ooo_cpu[cpu].L2C.sim_miss[cpu][LOAD];
+    miss[2] = uncore.LLC.sim_miss[cpu][LOAD];
+}
+
+// advance the sampling phases of core i, called every cycle of the ROI
+void sample_check(uint32_t i)
+{
+    SAMPLE_STATE *s = &sample[i];
+
+    if ((s->phase == SAMPLE_WARM) && (ooo_cpu[i].num_retired >= (s->unit_begin + sample_warm))) {
+        s->begin_instr = ooo_cpu[i].num_retired;
+        s->begin_cycle = current_core_cycle[i];
+        s->begin_mispredictions = ooo_cpu[i].branch_mispredictions;
+        sample_misses(i, s->begin_miss);
+        s->phase = SAMPLE_MEASURE;
+    }
+    else if ((s->phase == SAMPLE_MEASURE) && (ooo_cpu[i].num_retired >= (s->begin_instr + sample_window))) {
+        uint64_t miss[3];
+        double num_instr = ooo_cpu[i].num_retired - s->begin_instr;
+
+        sample_misses(i, miss);
+        s->cpi.push_back((current_core_cycle[i] - s->begin_cycle) / num_instr);
+        s->branch_mpki.push_back(1000.0 * (ooo_cpu[i].branch_mispredictions - s->begin_mispredictions) / num_instr);
+        for (uint32_t j=0; j<3; j++)
+            s->miss_mpki[j].push_back(1000.0 * (miss[j] - s->begin_miss[j]) / num_instr);
+
+        // stop fetching, the fast-forward starts from an empty pipeline
+        ooo_cpu[i].fetch_drain = 1;
+        s->phase = SAMPLE_DRAIN;
+    }
+    else if ((s->phase == SAMPLE_DRAIN) && (ooo_cpu[i].ROB.occupancy == 0)) {
+        uint64_t unit_end = s->unit_begin + sample_period,
+                 roi_end = ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions;
+        if (unit_end > roi_end)
+            unit_end = roi_end;
+
+        if (ooo_cpu[i].num_retired < unit_end) {
+            uint64_t num_warm = unit_end - ooo_cpu[i].num_retired;
+
+            ooo_cpu[i].warm_trace(num_warm);
+            ooo_cpu[i].num_retired += num_warm;
+            s->fast_forwarded += num_warm;
+
+            // the heartbeat only covers the detailed instructions
+            ooo_cpu[i].last_sim_instr += num_warm;
+            while (ooo_cpu[i].next_print_instruction <= ooo_cpu[i].num_retired)
+                ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+        }
+
+        ooo_cpu[i].fetch_drain = 0;
+        s->unit_begin = ooo_cpu[i].num_retired;
+        s->phase = SAMPLE_WARM;
+    }
+}
+
+// mean of the windows in v and the half width of its confidence interval
+void sample_estimate(const vector <double> &v, double &mean, double &half_width)
+{
+    double sum = 0, sum_square = 0;
+
+    for (uint32_t i=0; i<v.size(); i++) {
+        sum += v[i];
+        sum_square += v[i]*v[i];
+    }
+
+    mean = v.size() ? (sum / v.size()) : 0;
+    half_width = 0;
+    if (v.size() > 1) {
+        double variance = (sum_square - v.size()*mean*mean) / (v.size() - 1);
+        half_width = SAMPLE_Z * sqrt((variance > 0) ? variance : 0) / sqrt(v.size());
+    }
+}
+
+void print_sample_stats(uint32_t cpu)
+{
+    const char *miss_name[3] = {"L1D", "L2C", "LLC"};
+    SAMPLE_STATE *s = &sample[cpu];
+    double mean, half_width;
+
+    cout << endl << "CPU " << cpu << " sampled windows: " << s->cpi.size() << " detailed instructions: " << ooo_cpu[cpu].finish_sim_instr;
+    cout << " fast-forwarded instructions: " << s->fast_forwarded << endl;
+    if (s->cpi.size() == 0)
+        return;
+
+    sample_estimate(s->cpi, mean, half_width);
+    cout << "CPU " << cpu << " sampled IPC: " << 1 / mean << " CPI: " << mean << " +- " << half_width;
+    cout << " (" << 100 * half_width / mean << "% at 95% confidence)" << endl;
+
+    // windows needed for +-3% on the CPI, as in SMARTS
+    if (s->cpi.size() > 1) {
+        double variation = (half_width / SAMPLE_Z) * sqrt(s->cpi.size()) / mean;
+        cout << "CPU " << cpu << " windows needed for +-3% CPI: " << (uint64_t) ceil(pow(SAMPLE_Z * variation / 0.03, 2)) << endl;
+    }
+
+    sample_estimate(s->branch_mpki, mean, half_width);
+    cout << "CPU " << cpu << " sampled branch MPKI: " << mean << " +- " << half_width << endl;
+    for (uint32_t i=0; i<3; i++) {
+        sample_estimate(s->miss_mpki[i], mean, half_width);
+        cout << "CPU " << cpu << " sampled " << miss_name[i] << " load MPKI: " << mean << " +- " << half_width << endl;
+    }
+}
+
 void finish_warmup()
 {
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -197,17 +623,85 @@ void finish_warmup()
         ooo_cpu[i].L2C.LATENCY  = L2C_LATENCY;
     }
     uncore.LLC.LATENCY = LLC_LATENCY;
+
+    // the first sampling unit starts with the pipeline as the warmup left it
+    for (uint32_t i=0; sample_period && (i<NUM_CPUS); i++)
+        sample[i].unit_begin = ooo_cpu[i].num_retired;
+
+    if (save_checkpoint_file.size())
+        checkpoint.save(save_checkpoint_file);
+
+    if (fanout_values.size())
+        fanout();
+}
+
+// moves every core num_skip[i] records forward without translating them.
+// cores take turns every SKIP_STEP records, so that cores reading the same trace stay within the chunks it shares
+#define SKIP_STEP 1000000
+
+void skip_traces(vector <uint64_t> num_skip)
+{
+    for (uint64_t skipped = 0; ; skipped += SKIP_STEP) {
+        int remaining = 0;
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            if (num_skip[i] > skipped) {
+                ooo_cpu[i].skip_trace(((num_skip[i] - skipped) < SKIP_STEP) ? (num_skip[i] - skipped) : SKIP_STEP, 0);
+                remaining = 1;
+            }
+        }
+        if (remaining == 0)
+            break;
+    }
+}
+
+// the warmup was done outside the timing model (functional warmup or a checkpoint): start measuring right away
+void finish_warmup_early()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+        ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+        while (ooo_cpu[i].next_print_instruction <= ooo_cpu[i].num_retired)
+            ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+        warmup_complete[i] = 1;
+    }
+    all_warmup_complete = NUM_CPUS + 1;
+    finish_warmup();
+}
+
+// skip and warm up to the next region, the pipeline must be empty
+// a region that starts less than warmup_instructions after the end of the previous one starts late
+void start_simpoint()
+{
+    SIMPOINT *region = &simpoint[simpoint_next];
+    uint64_t position = ooo_cpu[0].skipped_instructions + ooo_cpu[0].num_retired,
+             warm_begin = (region->offset > warmup_instructions) ? (region->offset - warmup_instructions) : 0;
+
+    if (warm_begin > position) {
+        ooo_cpu[0].skip_trace(warm_begin - position, knob_skip_translate);
+        ooo_cpu[0].skipped_instructions += warm_begin - position;
+        position = warm_begin;
+    }
+
+    region->start = position + warmup_instructions;
+    cout << endl << "SimPoint region " << simpoint_next << " offset: " << region->offset << " start: " << region->start << " weight: " << region->weight << endl;
+
+    ooo_cpu[0].warm_trace(warmup_instructions);
+    ooo_cpu[0].num_retired += warmup_instructions;
+    ooo_cpu[0].fetch_drain = 0;
+    simpoint_next++;
+
+    finish_warmup_early();
 }
 
 void print_deadlock(uint32_t i)
 {
     cout << "DEADLOCK! CPU " << i << " instr_id: " << ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].instr_id;
-    cout << " translated: " << +ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].translated;
-    cout << " fetched: " << +ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].fetched;
-    cout << " scheduled: " << +ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].scheduled;
-    cout << " executed: " << +ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed;
+    cout << " translated: " << +ooo_cpu[i].ROB.translated[ooo_cpu[i].ROB.head];
+    cout << " fetched: " << +ooo_cpu[i].ROB.fetched[ooo_cpu[i].ROB.head];
+    cout << " scheduled: " << +ooo_cpu[i].ROB.scheduled[ooo_cpu[i].ROB.head];
+    cout << " executed: " << +ooo_cpu[i].ROB.executed[ooo_cpu[i].ROB.head];
     cout << " is_memory: " << +ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].is_memory;
-    cout << " event: " << ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle;
+    cout << " event: " << ooo_cpu[i].ROB.event_cycle[ooo_cpu[i].ROB.head];
     cout << " current: " << current_core_cycle[i] << endl;
 
     // print LQ entry
@@ -235,6 +729,214 @@ void print_deadlock(uint32_t i)
     assert(0);
 }
 
+uint64_t get_next_event_cycle()
+{
+    uint64_t next_event = uncore.LLC.get_next_event_cycle(),
+             dram_event = uncore.DRAM.get_next_event_cycle();
+
+    if (dram_event < next_event)
+        next_event = dram_event;
+
+    // requests still waiting in an LLC port go in as soon as the LLC has room
+    if (knob_threaded) {
+        for (int i=0; i<NUM_CPUS; i++) {
+            if (uncore.port[i].request.size() || uncore.port[i].walk.size())
+                return current_core_cycle[i] + 1;
+        }
+    }
+
+    for (int i=0; i<NUM_CPUS; i++) {
+        if (next_event <= current_core_cycle[i])
+            break;
+
+        uint64_t cpu_event = ooo_cpu[i].get_next_event_cycle();
+        if (cpu_event < next_event)
+            next_event = cpu_event;
+    }
+
+    return next_event;
+}
+
+// one cycle of core i and its private caches
+void operate_core(uint32_t i)
+{
+    // proceed one cycle
+    current_core_cycle[i]++;
+
+    //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
+    //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
+
+    // core might be stalled due to page fault or branch misprediction
+    if (stall_cycle[i] <= current_core_cycle[i]) {
+
+        // with -memory_only there is no pipeline
+        if (knob_memory_only) {
+            ooo_cpu[i].operate_memory_only();
+            return;
+        }
+
+        // fetch unit
+        if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
+            // handle branch
+            if ((ooo_cpu[i].fetch_stall == 0) && (ooo_cpu[i].fetch_drain == 0)) 
+                ooo_cpu[i].handle_branch();
+        }
+
+        // fetch
+        ooo_cpu[i].fetch_instruction();
+
+
+        // schedule (including decode latency)
+        uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
+        if ((ooo_cpu[i].ROB.scheduled[schedule_index] == 0) && (ooo_cpu[i].ROB.event_cycle[schedule_index] <= current_core_cycle[i]))
+            ooo_cpu[i].schedule_instruction();
+
+        // execute
+        ooo_cpu[i].execute_instruction();
+
+        // memory operation
+        ooo_cpu[i].schedule_memory_instruction();
+        ooo_cpu[i].execute_memory_instruction();
+
+        // complete 
+        ooo_cpu[i].update_rob();
+
+        // retire
+        if ((ooo_cpu[i].ROB.executed[ooo_cpu[i].ROB.head] == COMPLETED) && (ooo_cpu[i].ROB.event_cycle[ooo_cpu[i].ROB.head] <= current_core_cycle[i]))
+            ooo_cpu[i].retire_rob();
+    }
+}
+
+// heartbeat, deadlock, warmup and completion checks of core i
+void check_core(uint32_t i)
+{
+    uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
+             elapsed_minute = elapsed_second / 60,
+             elapsed_hour = elapsed_minute / 60;
+    elapsed_minute -= elapsed_hour*60;
+    elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+
+    // heartbeat information
+    if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
+        float cumulative_ipc;
+        if (warmup_complete[i])
+            cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
+        else
+            cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
+        float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
+
+        cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
+        cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
+        cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+        ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+
+        ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+        ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+    }
+
+    // check for deadlock
+    if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.event_cycle[ooo_cpu[i].ROB.head] + DEADLOCK_CYCLE) <= current_core_cycle[i])
+        print_deadlock(i);
+
+    // check for warmup
+    // warmup complete
+    if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > warmup_instructions)) {
+        warmup_complete[i] = 1;
+        all_warmup_complete++;
+    }
+    if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
+        all_warmup_complete++;
+        finish_warmup();
+    }
+
+    /*
+    if (all_warmup_complete == 0) { 
+        all_warmup_complete = 1;
+        finish_warmup();
+    }
+    if (ooo_cpu[1].num_retired > 0)
+        warmup_complete[1] = 1;
+    */
+    
+    if (sample_period && (all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0))
+        sample_check(i);
+
+    // with -simpoints, every region but the last one drains the pipeline and goes on to the next region
+    if ((simpoint_next < simpoint.size()) && (all_warmup_complete > NUM_CPUS) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
+        if (ooo_cpu[i].fetch_drain == 0) {
+            record_simpoint();
+            ooo_cpu[i].fetch_drain = 1;
+        }
+        if (ooo_cpu[i].ROB.occupancy == 0)
+            start_simpoint();
+        return;
+    }
+
+    // simulation complete
+    // with sampling, the ROI instructions are the detailed ones
+    if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
+        simulation_complete[i] = 1;
+        if (simpoint.size())
+            record_simpoint();
+        ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr - sample[i].fast_forwarded;
+        ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
+
+        cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
+        cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
+        cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+
+        record_roi_stats(i, &ooo_cpu[i].L1D);
+        record_roi_stats(i, &ooo_cpu[i].L1I);
+        record_roi_stats(i, &ooo_cpu[i].L2C);
+        record_roi_stats(i, &uncore.LLC);
+
+        all_simulation_complete++;
+    }
+
+    if (all_simulation_complete == NUM_CPUS)
+        run_simulation = 0;
+}
+
+// spin barrier between the main thread and the core threads of -threaded
+class CORE_BARRIER {
+  public:
+    uint32_t num_threads;
+    atomic<uint32_t> count, generation;
+
+    CORE_BARRIER(uint32_t n) : num_threads(n), count(0), generation(0) {}
+
+    void wait() {
+        uint32_t my_generation = generation.load();
+
+        if ((count.fetch_add(1) + 1) == num_threads) {
+            count.store(0);
+            generation.fetch_add(1);
+        }
+        else {
+            for (uint32_t spin = 0; generation.load() == my_generation; spin++) {
+                if (spin >= 1024)
+                    this_thread::yield();
+            }
+        }
+    }
+};
+
+CORE_BARRIER *core_barrier;
+
+// core i (i > 0) runs here with -threaded; core 0 runs on the main thread
+void run_core_thread(uint32_t i)
+{
+    while (1) {
+        core_barrier->wait();
+        if (run_simulation == 0)
+            break;
+
+        for (uint64_t j=0; j<sync_quantum; j++)
+            operate_core(i);
+        core_barrier->wait();
+    }
+}
+
 void signal_handler(int signal) 
 {
 	cout << "Caught signal: " << signal << endl;
@@ -411,7 +1113,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 
             // try to allocate pages contiguously
             if (fragmented) {
-                num_adjacent_page = 1 << (rand() % 10);
+                num_adjacent_page = 1 << (counted_rand() % 10);
                 DP ( if (warmup_complete[cpu]) {
                 cout << "Recalculate num_adjacent_page: " << num_adjacent_page << endl; });
             }
@@ -450,6 +1152,132 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     return pa;
 }
 
+// block arrays are one contiguous allocation, see cache.h
+void add_cache_checkpoint(CACHE *cache, string name)
+{
+    checkpoint.add_section(name, cache->block[0], cache->NUM_SET*cache->NUM_WAY*sizeof(BLOCK));
+}
+
+void put_map(vector<uint8_t> &buffer, map <uint64_t, uint64_t> &m)
+{
+    checkpoint_put(buffer, (uint64_t)m.size());
+    for (map <uint64_t, uint64_t>::iterator it = m.begin(); it != m.end(); it++) {
+        checkpoint_put(buffer, it->first);
+        checkpoint_put(buffer, it->second);
+    }
+}
+
+void get_map(const vector<uint8_t> &buffer, uint64_t &offset, map <uint64_t, uint64_t> &m)
+{
+    m.clear();
+    uint64_t num_entry = checkpoint_get<uint64_t>(buffer, offset);
+    for (uint64_t i=0; i<num_entry; i++) {
+        uint64_t key = checkpoint_get<uint64_t>(buffer, offset);
+        m[key] = checkpoint_get<uint64_t>(buffer, offset);
+    }
+}
+
+// state owned by main: caches, page table and where each core is in its trace
+// (predictors, prefetchers and replacement policies add their own sections when they are initialized)
+void add_checkpoint_sections()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        string cpu_name = "cpu" + to_string(i);
+
+        checkpoint.add_section(cpu_name + ".core",
+            [i](vector<uint8_t> &buffer) {
+                checkpoint_put(buffer, ooo_cpu[i].skipped_instructions + ooo_cpu[i].num_retired); // next trace record to simulate
+                checkpoint_put(buffer, ooo_cpu[i].num_retired);
+                checkpoint_put(buffer, current_core_cycle[i]);
+            },
+            [i](const vector<uint8_t> &buffer) {
+                uint64_t offset = 0,
+                         trace_position = checkpoint_get<uint64_t>(buffer, offset);
+                ooo_cpu[i].num_retired = checkpoint_get<uint64_t>(buffer, offset);
+                ooo_cpu[i].instr_unique_id = ooo_cpu[i].num_retired;
+                ooo_cpu[i].skipped_instructions = trace_position - ooo_cpu[i].num_retired;
+                current_core_cycle[i] = checkpoint_get<uint64_t>(buffer, offset);
+            });
+
+        add_cache_checkpoint(&ooo_cpu[i].ITLB, cpu_name + ".ITLB");
+        add_cache_checkpoint(&ooo_cpu[i].DTLB, cpu_name + ".DTLB");
+        add_cache_checkpoint(&ooo_cpu[i].STLB, cpu_name + ".STLB");
+        add_cache_checkpoint(&ooo_cpu[i].L1I, cpu_name + ".L1I");
+        add_cache_checkpoint(&ooo_cpu[i].L1D, cpu_name + ".L1D");
+        add_cache_checkpoint(&ooo_cpu[i].L2C, cpu_name + ".L2C");
+    }
+    add_cache_checkpoint(&uncore.LLC, "LLC");
+
+    checkpoint.add_section("page_table",
+        [](vector<uint8_t> &buffer) {
+            put_map(buffer, page_table);
+            put_map(buffer, inverse_table);
+            put_map(buffer, recent_page);
+            for (uint32_t i=0; i<NUM_CPUS; i++) {
+                put_map(buffer, unique_cl[i]);
+                checkpoint_put(buffer, num_cl[i]);
+                checkpoint_put(buffer, num_page[i]);
+                checkpoint_put(buffer, minor_fault[i]);
+                checkpoint_put(buffer, major_fault[i]);
+            }
+            checkpoint_put(buffer, previous_ppage);
+            checkpoint_put(buffer, num_adjacent_page);
+            checkpoint_put(buffer, allocated_pages);
+
+            queue <uint64_t> pages = page_queue;
+            checkpoint_put(buffer, (uint64_t)pages.size());
+            for (; pages.size(); pages.pop())
+                checkpoint_put(buffer, pages.front());
+
+            // the generator that picks physical pages
+            ostringstream rand_state;
+            rand_state << champsim_rand.engine;
+            string rand_string = rand_state.str();
+            checkpoint_put(buffer, (uint64_t)rand_string.size());
+            buffer.insert(buffer.end(), rand_string.begin(), rand_string.end());
+        },
+        [](const vector<uint8_t> &buffer) {
+            uint64_t offset = 0;
+            get_map(buffer, offset, page_table);
+            get_map(buffer, offset, inverse_table);
+            get_map(buffer, offset, recent_page);
+            for (uint32_t i=0; i<NUM_CPUS; i++) {
+                get_map(buffer, offset, unique_cl[i]);
+                num_cl[i] = checkpoint_get<uint64_t>(buffer, offset);
+                num_page[i] = checkpoint_get<uint64_t>(buffer, offset);
+                minor_fault[i] = checkpoint_get<uint64_t>(buffer, offset);
+                major_fault[i] = checkpoint_get<uint64_t>(buffer, offset);
+            }
+            previous_ppage = checkpoint_get<uint64_t>(buffer, offset);
+            num_adjacent_page = checkpoint_get<uint64_t>(buffer, offset);
+            allocated_pages = checkpoint_get<uint64_t>(buffer, offset);
+
+            page_queue = queue <uint64_t>();
+            uint64_t num_pages = checkpoint_get<uint64_t>(buffer, offset);
+            for (uint64_t i=0; i<num_pages; i++)
+                page_queue.push(checkpoint_get<uint64_t>(buffer, offset));
+
+            uint64_t rand_size = checkpoint_get<uint64_t>(buffer, offset);
+            assert((offset + rand_size) <= buffer.size());
+            istringstream rand_state(string(buffer.begin() + offset, buffer.begin() + offset + rand_size));
+            rand_state >> champsim_rand.engine;
+        });
+
+    checkpoint.add_section("libc_rand",
+        [](vector<uint8_t> &buffer) {
+            checkpoint_put(buffer, libc_rand_draws);
+        },
+        [](const vector<uint8_t> &buffer) {
+            // replay the draws from the seed, the state of rand() itself is hidden
+            uint64_t offset = 0,
+                     num_draws = checkpoint_get<uint64_t>(buffer, offset);
+            srand(champsim_seed);
+            libc_rand_draws = 0;
+            while (libc_rand_draws < num_draws)
+                counted_rand();
+        });
+}
+
 int main(int argc, char** argv)
 {
 	// interrupt signal hanlder
@@ -462,8 +1290,6 @@ int main(int argc, char** argv)
     cout << endl << "*** ChampSim Multicore Out-of-Order Simulator ***" << endl << endl;
 
     // initialize knobs
-    uint8_t show_heartbeat = 1;
-
     uint32_t seed_number = 0;
 
     // check to see if knobs changed using getopt_long()
@@ -476,6 +1302,31 @@ int main(int argc, char** argv)
             {"hide_heartbeat", no_argument, 0, 'h'},
             {"cloudsuite", no_argument, 0, 'c'},
             {"low_bandwidth",  no_argument, 0, 'b'},
+            {"event_skip",  no_argument, 0, 'e'},
+            {"threaded",  no_argument, 0, 'p'},
+            {"sync_quantum",  required_argument, 0, 'q'},
+            {"skip_instructions", required_argument, 0, 'k'},
+            {"skip_translate",  no_argument, 0, 'a'},
+            {"functional_warmup",  no_argument, 0, 'f'},
+            {"save_checkpoint", required_argument, 0, 'o'},
+            {"load_checkpoint", required_argument, 0, 'r'},
+            {"branch", required_argument, 0, 'B'},
+            {"l1d_pref", required_argument, 0, '1'},
+            {"l2c_pref", required_argument, 0, '2'},
+            {"llc_pref", required_argument, 0, '3'},
+            {"llc_repl", required_argument, 0, 'R'},
+            {"sample_period", required_argument, 0, 'S'},
+            {"sample_window", required_argument, 0, 'W'},
+            {"sample_warm", required_argument, 0, 'U'},
+            {"simpoints", required_argument, 0, 'M'},
+            {"fanout", required_argument, 0, 'F'},
+            {"fanout_output", required_argument, 0, 'O'},
+            {"trace_server",  no_argument, 0, 'T'},
+            {"memory_only",  no_argument, 0, 'm'},
+            {"prefetcher_replay", required_argument, 0, 'P'},
+            {"replay_stream", required_argument, 0, 'y'},
+            {"record_stream", required_argument, 0, 'x'},
+            {"record_stream_file", required_argument, 0, 'X'},
             {"traces",  no_argument, 0, 't'},
             {0, 0, 0, 0}      
         };
@@ -507,6 +1358,92 @@ int main(int argc, char** argv)
             case 'b':
                 knob_low_bandwidth = 1;
                 break;
+            case 'e':
+                knob_event_skip = 1;
+                break;
+            case 'p':
+                knob_threaded = 1;
+                break;
+            case 'q':
+                sync_quantum = atol(optarg);
+                break;
+            case 'k':
+                skip_instructions = atol(optarg);
+                break;
+            case 'a':
+                knob_skip_translate = 1;
+                break;
+            case 'f':
+                knob_functional_warmup = 1;
+                break;
+            case 'o':
+                save_checkpoint_file = optarg;
+                break;
+            case 'r':
+                load_checkpoint_file = optarg;
+                break;
+            case 'B':
+                branch_name = optarg;
+                break;
+            case '1':
+                l1d_pref_name = optarg;
+                break;
+            case '2':
+                l2c_pref_name = optarg;
+                break;
+            case '3':
+                llc_pref_name = optarg;
+                break;
+            case 'R':
+                llc_repl_name = optarg;
+                break;
+            case 'S':
+                sample_period = atol(optarg);
+                break;
+            case 'W':
+                sample_window = atol(optarg);
+                break;
+            case 'U':
+                sample_warm = atol(optarg);
+                break;
+            case 'M':
+                simpoint_file = optarg;
+                break;
+            case 'F': {
+                string arg = optarg, value;
+                size_t eq = arg.find('=');
+                if (eq == string::npos) {
+                    cerr << "-fanout takes KNOB=value1,value2,... (KNOB is branch, l1d_pref, l2c_pref, llc_pref or llc_repl)" << endl;
+                    assert(0);
+                }
+                fanout_knob = arg.substr(0, eq);
+                stringstream values(arg.substr(eq+1));
+                while (getline(values, value, ','))
+                    if (value.size())
+                        fanout_values.push_back(value);
+                break;
+            }
+            case 'O':
+                fanout_output = optarg;
+                break;
+            case 'T':
+                knob_trace_server = 1;
+                break;
+            case 'm':
+                knob_memory_only = 1;
+                break;
+            case 'P':
+                prefetcher_replay_level = optarg;
+                break;
+            case 'y':
+                replay_stream_file = optarg;
+                break;
+            case 'x':
+                record_stream_level = optarg;
+                break;
+            case 'X':
+                record_stream_file = optarg;
+                break;
             case 't':
                 traces_encountered = 1;
                 break;
@@ -519,12 +1456,123 @@ int main(int argc, char** argv)
     }
 
     // consequences of knobs
-    cout << "Warmup Instructions: " << warmup_instructions << endl;
+    cout << "Warmup Instructions: " << warmup_instructions << (knob_functional_warmup ? " (functional)" : "") << endl;
     cout << "Simulation Instructions: " << simulation_instructions << endl;
+    if (load_checkpoint_file.size())
+        cout << "Load Checkpoint: " << load_checkpoint_file << " (replaces skip and warmup)" << endl;
+    if (save_checkpoint_file.size())
+        cout << "Save Checkpoint: " << save_checkpoint_file << endl;
+    if (skip_instructions)
+        cout << "Skip Instructions: " << skip_instructions << (knob_skip_translate ? " (with page table updates)" : "") << endl;
     //cout << "Scramble Loads: " << (knob_scramble_loads ? "ture" : "false") << endl;
     cout << "Number of CPUs: " << NUM_CPUS << endl;
     cout << "LLC sets: " << LLC_SET << endl;
     cout << "LLC ways: " << LLC_WAY << endl;
+    cout << "Branch Predictor: " << branch_name << endl;
+    cout << "L1D Prefetcher: " << l1d_pref_name << endl;
+    cout << "L2C Prefetcher: " << l2c_pref_name << endl;
+    cout << "LLC Prefetcher: " << llc_pref_name << endl;
+    cout << "LLC Replacement: " << llc_repl_name << endl;
+    if (simpoint_file.size()) {
+        read_simpoints(simpoint_file);
+        cout << "SimPoints: " << simpoint_file << " (" << simpoint.size() << " regions, functional warmup)" << endl;
+
+        // the regions are located by instruction offset in one trace, and each of them is warmed up functionally
+        if ((NUM_CPUS > 1) || skip_instructions || load_checkpoint_file.size() || save_checkpoint_file.size() || sample_period || fanout_values.size()) {
+            cerr << "-simpoints needs a single-core binary and does not combine with -skip_instructions, checkpoints, -sample_period or -fanout" << endl;
+            assert(0);
+        }
+        knob_functional_warmup = 1;
+    }
+    if (sample_period) {
+        cout << "Sampling: period " << sample_period << " window " << sample_window << " detailed warm " << sample_warm << endl;
+        if ((sample_window == 0) || ((sample_warm + sample_window) >= sample_period)) {
+            cerr << "-sample_window must be at least 1 and -sample_warm plus -sample_window less than -sample_period" << endl;
+            assert(0);
+        }
+    }
+    if (fanout_values.size()) {
+        cout << "Fan-out: " << fanout_knob << "=";
+        for (uint32_t n=0; n<fanout_values.size(); n++)
+            cout << (n ? "," : "") << fanout_values[n];
+        cout << " (stats in " << fanout_output << "." << fanout_knob << "=VALUE.txt)" << endl;
+
+        // check every value now rather than after the warmup
+        for (uint32_t n=0; n<fanout_values.size(); n++) {
+            if (fanout_knob == "branch")
+                delete MODULE_REGISTRY<BRANCH_PREDICTOR>::create(fanout_values[n], "branch predictor");
+            else if ((fanout_knob == "l1d_pref") || (fanout_knob == "l2c_pref") || (fanout_knob == "llc_pref"))
+                delete MODULE_REGISTRY<PREFETCHER>::create(fanout_knob.substr(0, 3) + "." + fanout_values[n], "prefetcher");
+            else if (fanout_knob == "llc_repl")
+                delete MODULE_REGISTRY<REPLACEMENT>::create(fanout_values[n], "LLC replacement policy");
+            else {
+                cerr << "-fanout knob must be branch, l1d_pref, l2c_pref, llc_pref or llc_repl, not " << fanout_knob << endl;
+                assert(0);
+            }
+        }
+
+        // the children are forked from the main thread, so the core threads must not have started yet
+        if (knob_threaded && !(knob_functional_warmup && warmup_instructions) && (load_checkpoint_file.size() == 0)) {
+            cerr << "-fanout with -threaded needs -functional_warmup or -load_checkpoint" << endl;
+            assert(0);
+        }
+    }
+    if (knob_memory_only) {
+        cout << "Memory-only: on (no pipeline, loads and stores go straight to the L1D)" << endl;
+
+        // the pipeline is what sampling and simpoints drain, and threaded cores cannot translate on their own
+        if (sample_period || simpoint_file.size() || knob_threaded) {
+            cerr << "-memory_only does not combine with -sample_period, -simpoints or -threaded" << endl;
+            assert(0);
+        }
+    }
+    if (prefetcher_replay_level.size()) {
+        cout << "Prefetcher replay: " << prefetcher_replay_level << " (no timing, idealized tag stores)" << endl;
+
+        if ((prefetcher_replay_level != "l1d") && (prefetcher_replay_level != "l2c")) {
+            cerr << "-prefetcher_replay takes l1d or l2c" << endl;
+            assert(0);
+        }
+        if ((NUM_CPUS > 1) || knob_functional_warmup || knob_memory_only || knob_threaded || sample_period || simpoint_file.size() || fanout_values.size()
+            || load_checkpoint_file.size() || save_checkpoint_file.size()) {
+            cerr << "-prefetcher_replay needs a single-core binary and takes no other mode than -skip_instructions" << endl;
+            assert(0);
+        }
+        if (replay_stream_file.size()) {
+            cout << "Replay stream: " << replay_stream_file << " (instead of the trace)" << endl;
+            if (skip_instructions) {
+                cerr << "-replay_stream does not combine with -skip_instructions" << endl;
+                assert(0);
+            }
+        }
+    }
+    else if (replay_stream_file.size()) {
+        cerr << "-replay_stream needs -prefetcher_replay" << endl;
+        assert(0);
+    }
+    if (record_stream_level.size()) {
+        if (record_stream_file.empty())
+            record_stream_file = record_stream_level + ".champsimstream";
+        cout << "Record stream: " << record_stream_level << " accesses to " << record_stream_file << endl;
+
+        if ((record_stream_level != "L1D") && (record_stream_level != "L2C") && (record_stream_level != "LLC") && (record_stream_level != "DRAM")) {
+            cerr << "-record_stream takes L1D, L2C, LLC or DRAM" << endl;
+            assert(0);
+        }
+        // the forked children would have no writer thread, and the replay has no hierarchy to record
+        if (fanout_values.size() || prefetcher_replay_level.size()) {
+            cerr << "-record_stream does not combine with -fanout or -prefetcher_replay" << endl;
+            assert(0);
+        }
+    }
+    if (knob_event_skip)
+        cout << "Event skipping: on" << endl;
+    if (knob_threaded)
+        cout << "Threaded cores: on (sync quantum: " << sync_quantum << " cycles)" << endl;
+    if (sync_quantum == 0) {
+        cout << "sync_quantum must be at least 1 cycle" << endl;
+        assert(0);
+    }
 
     if (knob_low_bandwidth)
         DRAM_MTPS = DRAM_IO_FREQ/4;
@@ -566,12 +1614,8 @@ int main(int argc, char** argv)
 			}
 				
 
-            if (full_name[last_dot - full_name + 1] == 'g') // gzip format
-                sprintf(ooo_cpu[count_traces].gunzip_command, "gunzip -c %s", argv[i]);
-            else if (full_name[last_dot - full_name + 1] == 'x') // xz
-                sprintf(ooo_cpu[count_traces].gunzip_command, "xz -dc %s", argv[i]);
-            else {
-                cout << "ChampSim does not support traces other than gz or xz compression!" << endl; 
+            if ((last_dot == NULL) || ((full_name[last_dot - full_name + 1] != 'g') && (full_name[last_dot - full_name + 1] != 'x') && (full_name[last_dot - full_name + 1] != 'b'))) {
+                cout << "ChampSim does not support traces other than gz, xz or blk!" << endl; 
                 assert(0);
             }
 
@@ -594,9 +1638,15 @@ int main(int argc, char** argv)
                 j++;
             }
 
-            ooo_cpu[count_traces].trace_file = popen(ooo_cpu[count_traces].gunzip_command, "r");
-            if (ooo_cpu[count_traces].trace_file == NULL) {
-                printf("\n*** Trace file not found: %s ***\n\n", argv[i]);
+            // decompressed in process or mapped, see trace_reader.h; cores running the same trace share its decoder
+            if (NUM_CPUS > 1)
+                ooo_cpu[count_traces].trace_file = open_shared_trace(ooo_cpu[count_traces].trace_string);
+            else
+                ooo_cpu[count_traces].trace_file = open_trace(ooo_cpu[count_traces].trace_string);
+            uint32_t record_size = ooo_cpu[count_traces].trace_file->record_size;
+            if (record_size && (record_size != (knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr)))) {
+                cout << "Trace records are " << record_size << " bytes, " << (knob_cloudsuite ? "cloudsuite" : "regular") << " records are "
+                     << (knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr)) << endl;
                 assert(0);
             }
 
@@ -611,7 +1661,7 @@ int main(int argc, char** argv)
         }
     }
 
-    if (count_traces != NUM_CPUS) {
+    if ((count_traces != NUM_CPUS) && replay_stream_file.empty()) {
         printf("\n*** Not enough traces for the configured number of cores ***\n\n");
         assert(0);
     }
@@ -632,6 +1682,7 @@ int main(int argc, char** argv)
         ooo_cpu[i].ROB.cpu = i;
 
         // BRANCH PREDICTOR
+        ooo_cpu[i].branch_predictor = MODULE_REGISTRY<BRANCH_PREDICTOR>::create(branch_name, "branch predictor");
         ooo_cpu[i].initialize_branch_predictor();
 
         // TLBs
@@ -666,7 +1717,8 @@ int main(int argc, char** argv)
         ooo_cpu[i].L1D.MAX_READ = (2 > MAX_READ_PER_CYCLE) ? MAX_READ_PER_CYCLE : 2;
         ooo_cpu[i].L1D.fill_level = FILL_L1;
         ooo_cpu[i].L1D.lower_level = &ooo_cpu[i].L2C; 
-        ooo_cpu[i].L1D.l1d_prefetcher_initialize();
+        ooo_cpu[i].L1D.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("l1d." + l1d_pref_name, "L1D prefetcher");
+        ooo_cpu[i].L1D.prefetcher_initialize();
 
         ooo_cpu[i].L2C.cpu = i;
         ooo_cpu[i].L2C.cache_type = IS_L2C;
@@ -674,7 +1726,16 @@ int main(int argc, char** argv)
         ooo_cpu[i].L2C.upper_level_icache[i] = &ooo_cpu[i].L1I;
         ooo_cpu[i].L2C.upper_level_dcache[i] = &ooo_cpu[i].L1D;
         ooo_cpu[i].L2C.lower_level = &uncore.LLC;
-        ooo_cpu[i].L2C.l2c_prefetcher_initialize();
+        ooo_cpu[i].L2C.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("l2c." + l2c_pref_name, "L2C prefetcher");
+        ooo_cpu[i].L2C.prefetcher_initialize();
+
+        // with -threaded, the L2C goes through a per-core port instead of accessing the shared LLC
+        if (knob_threaded) {
+            uncore.port[i].cpu = i;
+            uncore.port[i].stlb = &ooo_cpu[i].STLB;
+            uncore.port[i].lower_level = &uncore.LLC;
+            ooo_cpu[i].L2C.lower_level = &uncore.port[i];
+        }
 
         // SHARED CACHE
         uncore.LLC.cache_type = IS_LLC;
@@ -707,132 +1768,148 @@ int main(int argc, char** argv)
         major_fault[i] = 0;
     }
 
+    uncore.LLC.replacement = MODULE_REGISTRY<REPLACEMENT>::create(llc_repl_name, "LLC replacement policy");
     uncore.LLC.llc_initialize_replacement();
-    uncore.LLC.llc_prefetcher_initialize();
-
-    // simulation entry point
-    start_time = time(NULL);
-    uint8_t run_simulation = 1;
-    while (run_simulation) {
+    uncore.LLC.prefetcher = MODULE_REGISTRY<PREFETCHER>::create("llc." + llc_pref_name, "LLC prefetcher");
+    uncore.LLC.prefetcher_initialize();
 
-        uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
-                 elapsed_minute = elapsed_second / 60,
-                 elapsed_hour = elapsed_minute / 60;
-        elapsed_minute -= elapsed_hour*60;
-        elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+    add_checkpoint_sections();
 
+    // every recording cache gets its own buffer, the writer thread takes whole blocks from them
+    if (record_stream_level.size()) {
+        stream_writer = new ACCESS_STREAM_WRITER(record_stream_file, record_stream_level);
         for (int i=0; i<NUM_CPUS; i++) {
-            // proceed one cycle
-            current_core_cycle[i]++;
-
-            //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
-            //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
+            if (record_stream_level == "L1D") {
+                access_stream.push_back(new ACCESS_STREAM(stream_writer));
+                ooo_cpu[i].L1D.stream = access_stream.back();
+            }
+            else if (record_stream_level == "L2C") {
+                access_stream.push_back(new ACCESS_STREAM(stream_writer));
+                ooo_cpu[i].L2C.stream = access_stream.back();
+            }
+        }
+        if (record_stream_level == "LLC") {
+            access_stream.push_back(new ACCESS_STREAM(stream_writer));
+            uncore.LLC.stream = access_stream.back();
+        }
+        else if (record_stream_level == "DRAM") {
+            access_stream.push_back(new ACCESS_STREAM(stream_writer));
+            uncore.DRAM.stream = access_stream.back();
+        }
+    }
 
-            // core might be stalled due to page fault or branch misprediction
-            if (stall_cycle[i] <= current_core_cycle[i]) {
+    // fast-forward every trace past its first skip_instructions records (a checkpoint knows its own position)
+    if (skip_instructions && (load_checkpoint_file.size() == 0)) {
+        // page allocation follows the order the pages are translated in, so translating skips stay one core at a time
+        for (int i=0; i<NUM_CPUS; i++) {
+            if (knob_skip_translate)
+                ooo_cpu[i].skip_trace(skip_instructions, knob_skip_translate);
+            ooo_cpu[i].skipped_instructions = skip_instructions;
+        }
+        if (knob_skip_translate == 0)
+            skip_traces(vector <uint64_t> (NUM_CPUS, skip_instructions));
+        cout << "Skipped " << skip_instructions << " instructions per CPU" << endl;
+    }
 
-                // fetch unit
-                if (ooo_cpu[i].ROB.occupancy < ooo_cpu[i].ROB.SIZE) {
-                    // handle branch
-                    if (ooo_cpu[i].fetch_stall == 0) 
-                        ooo_cpu[i].handle_branch();
-                }
+    if (prefetcher_replay_level.size()) {
+        replay_prefetcher(prefetcher_replay_level, replay_stream_file, warmup_instructions, simulation_instructions);
+        return 0;
+    }
 
-                // fetch
-                ooo_cpu[i].fetch_instruction();
+    // simulation entry point
+    start_time = time(NULL);
 
+    if (simpoint.size())
+        start_simpoint();
+    else if (load_checkpoint_file.size()) {
+        // resume at the first instruction that had not retired when the checkpoint was taken
+        checkpoint.load(load_checkpoint_file);
+        vector <uint64_t> num_skip;
+        for (int i=0; i<NUM_CPUS; i++)
+            num_skip.push_back(ooo_cpu[i].skipped_instructions + ooo_cpu[i].num_retired);
+        skip_traces(num_skip);
+        finish_warmup_early();
+    }
+    else if (knob_functional_warmup && warmup_instructions) {
+        // warm up the caches, TLBs and branch predictors without the timing model
+        // cores take turns every 1000 instructions so that they share the LLC roughly as they would in the detailed warmup
+        for (uint64_t warmed = 0; warmed < warmup_instructions; warmed += 1000) {
+            uint64_t num_warm = ((warmup_instructions - warmed) < 1000) ? (warmup_instructions - warmed) : 1000;
+            for (int i=0; i<NUM_CPUS; i++)
+                ooo_cpu[i].warm_trace(num_warm);
+        }
 
-                // schedule (including decode latency)
-                uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
-                if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].schedule_instruction();
+        for (int i=0; i<NUM_CPUS; i++)
+            ooo_cpu[i].num_retired = warmup_instructions;
+        finish_warmup_early();
+    }
 
-                // execute
-                ooo_cpu[i].execute_instruction();
+    CORE_BARRIER barrier(NUM_CPUS);
+    vector <thread> core_thread;
+    if (knob_threaded) {
+        core_barrier = &barrier;
+        for (int i=1; i<NUM_CPUS; i++)
+            core_thread.push_back(thread(run_core_thread, i));
+    }
 
-                // memory operation
-                ooo_cpu[i].schedule_memory_instruction();
-                ooo_cpu[i].execute_memory_instruction();
+    while (run_simulation) {
 
-                // complete 
-                ooo_cpu[i].update_rob();
+        if (knob_threaded) {
+            // the cores run their quantum in parallel
+            core_barrier->wait();
+            for (uint64_t j=0; j<sync_quantum; j++)
+                operate_core(0);
+            core_barrier->wait();
+
+            // every core is parked now, so replay the shared part of the quantum cycle by cycle
+            uint64_t end_cycle = current_core_cycle[0];
+            for (uint64_t cycle = end_cycle - sync_quantum + 1; cycle <= end_cycle; cycle++) {
+                for (int i=0; i<NUM_CPUS; i++)
+                    current_core_cycle[i] = cycle;
+
+                for (int i=0; i<NUM_CPUS; i++) {
+                    uncore.port[i].drain(cycle);
+                    if (cycle == end_cycle)
+                        check_core(i);
+                }
 
-                // retire
-                if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
-                    ooo_cpu[i].retire_rob();
+                uncore.LLC.operate();
+                uncore.DRAM.operate();
             }
-
-            // heartbeat information
-            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
-                float cumulative_ipc;
-                if (warmup_complete[i])
-                    cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
-                else
-                    cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
-                float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
-
-                cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
-                cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-                ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
-
-                ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
-                ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+            uncore.update_port_view();
+        }
+        else {
+            for (int i=0; i<NUM_CPUS; i++) {
+                operate_core(i);
+                check_core(i);
             }
 
-            // check for deadlock
-            if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
-                print_deadlock(i);
-
-            // check for warmup
-            // warmup complete
-            if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > warmup_instructions)) {
-                warmup_complete[i] = 1;
-                all_warmup_complete++;
-            }
-            if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
-                all_warmup_complete++;
-                finish_warmup();
-            }
+            // TODO: should it be backward?
+            uncore.LLC.operate();
+            uncore.DRAM.operate();
+        }
 
-            /*
-            if (all_warmup_complete == 0) { 
-                all_warmup_complete = 1;
-                finish_warmup();
+        // jump over the cycles in which no component can make progress
+        // all cores advance together, so current_core_cycle is the same for every cpu here
+        if (knob_event_skip && run_simulation) {
+            uint64_t next_event = get_next_event_cycle();
+            if ((next_event != UINT64_MAX) && (next_event > (current_core_cycle[0] + 1))) {
+                for (int i=0; i<NUM_CPUS; i++)
+                    current_core_cycle[i] = next_event - 1;
             }
-            if (ooo_cpu[1].num_retired > 0)
-                warmup_complete[1] = 1;
-            */
-            
-            // simulation complete
-            if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
-                simulation_complete[i] = 1;
-                ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
-                ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
-
-                cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
-                cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-
-                record_roi_stats(i, &ooo_cpu[i].L1D);
-                record_roi_stats(i, &ooo_cpu[i].L1I);
-                record_roi_stats(i, &ooo_cpu[i].L2C);
-                record_roi_stats(i, &uncore.LLC);
-
-                all_simulation_complete++;
-            }
-
-            if (all_simulation_complete == NUM_CPUS)
-                run_simulation = 0;
         }
+    }
 
-        // TODO: should it be backward?
-        uncore.LLC.operate();
-        uncore.DRAM.operate();
+    if (knob_threaded) {
+        // release the core threads so that they see the end of the simulation
+        core_barrier->wait();
+        for (uint32_t i=0; i<core_thread.size(); i++)
+            core_thread[i].join();
     }
 
 #ifndef CRC2_COMPILE
-    print_branch_stats();
+    if (knob_memory_only == 0)
+        print_branch_stats();
 #endif
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
              elapsed_minute = elapsed_second / 60,
@@ -841,6 +1918,13 @@ int main(int argc, char** argv)
     elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
     
     cout << endl << "ChampSim completed all CPUs" << endl;
+    if (stream_writer) {
+        for (uint32_t n=0; n<access_stream.size(); n++)
+            access_stream[n]->flush();
+        stream_writer->close();
+        cout << "Recorded " << stream_writer->num_records << " " << record_stream_level << " accesses in " << record_stream_file
+             << " (" << stream_writer->num_bytes << " bytes)" << endl;
+    }
     if (NUM_CPUS > 1) {
         cout << endl << "Total Simulation Statistics (not including warmup)" << endl;
         for (uint32_t i=0; i<NUM_CPUS; i++) {
@@ -850,12 +1934,12 @@ int main(int argc, char** argv)
             print_sim_stats(i, &ooo_cpu[i].L1D);
             print_sim_stats(i, &ooo_cpu[i].L1I);
             print_sim_stats(i, &ooo_cpu[i].L2C);
-            ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
-            ooo_cpu[i].L2C.l2c_prefetcher_final_stats();
+            ooo_cpu[i].L1D.prefetcher_final_stats();
+            ooo_cpu[i].L2C.prefetcher_final_stats();
 #endif
             print_sim_stats(i, &uncore.LLC);
         }
-        uncore.LLC.llc_prefetcher_final_stats();
+        uncore.LLC.prefetcher_final_stats();
     }
 
     cout << endl << "Region of Interest Statistics" << endl;
@@ -871,12 +1955,18 @@ int main(int argc, char** argv)
         cout << "Major fault: " << major_fault[i] << " Minor fault: " << minor_fault[i] << endl;
     }
 
+    for (uint32_t i=0; sample_period && (i<NUM_CPUS); i++)
+        print_sample_stats(i);
+
+    if (simpoint.size())
+        print_simpoint_stats();
+
     for (uint32_t i=0; i<NUM_CPUS; i++) {
-        ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
-        ooo_cpu[i].L2C.l2c_prefetcher_final_stats();
+        ooo_cpu[i].L1D.prefetcher_final_stats();
+        ooo_cpu[i].L2C.prefetcher_final_stats();
     }
 
-    uncore.LLC.llc_prefetcher_final_stats();
+    uncore.LLC.prefetcher_final_stats();
 
 #ifndef CRC2_COMPILE
     uncore.LLC.llc_replacement_final_stats();
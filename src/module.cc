@@ -0,0 +1,105 @@
+#include "ooo_cpu.h"
+
+// the hooks called by the core and the caches forward to the modules chosen at startup
+
+string BRANCH_PREDICTOR::section_name(string name)
+{
+    return "cpu" + to_string(cpu) + "." + name;
+}
+
+int PREFETCHER::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int prefetch_fill_level, uint32_t prefetch_metadata)
+{
+    return cache->prefetch_line(ip, base_addr, pf_addr, prefetch_fill_level, prefetch_metadata);
+}
+
+string PREFETCHER::section_name(string name)
+{
+    if (cache->cache_type == IS_LLC)
+        return cache->NAME + "." + name;
+    return "cpu" + to_string(cpu) + "." + cache->NAME + "." + name;
+}
+
+string REPLACEMENT::section_name(string name)
+{
+    return cache->NAME + "." + name;
+}
+
+void O3_CPU::initialize_branch_predictor()
+{
+    branch_predictor->ooo = this;
+    branch_predictor->cpu = cpu;
+    branch_predictor->initialize();
+}
+
+uint8_t O3_CPU::predict_branch(uint64_t ip)
+{
+    return branch_predictor->predict_branch(ip);
+}
+
+void O3_CPU::last_branch_result(uint64_t ip, uint8_t taken)
+{
+    branch_predictor->last_branch_result(ip, taken);
+}
+
+void CACHE::prefetcher_initialize()
+{
+    prefetcher->cache = this;
+    prefetcher->cpu = cpu;
+    prefetcher->initialize();
+}
+
+void CACHE::l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type)
+{
+    prefetcher->operate(addr, ip, cache_hit, type, 0);
+}
+
+uint32_t CACHE::l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+    return prefetcher->operate(addr, ip, cache_hit, type, metadata_in);
+}
+
+uint32_t CACHE::llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+    return prefetcher->operate(addr, ip, cache_hit, type, metadata_in);
+}
+
+void CACHE::l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+    prefetcher->cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+uint32_t CACHE::l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+    return prefetcher->cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+uint32_t CACHE::llc_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+    return prefetcher->cache_fill(addr, set, way, prefetch, evicted_addr, metadata_in);
+}
+
+void CACHE::prefetcher_final_stats()
+{
+    prefetcher->final_stats();
+}
+
+void CACHE::llc_initialize_replacement()
+{
+    replacement->cache = this;
+    replacement->initialize();
+}
+
+uint32_t CACHE::llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type)
+{
+    return replacement->find_victim(cpu, instr_id, set, current_set, ip, full_addr, type);
+}
+
+void CACHE::llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit)
+{
+    replacement->update_replacement_state(cpu, set, way, full_addr, ip, victim_addr, type, hit);
+}
+
+void CACHE::llc_replacement_final_stats()
+{
+    replacement->final_stats();
+}
@@ -11,6 +11,105 @@ void O3_CPU::initialize_core()
 
 }
 
+// read the next batch of records and convert them into the performance model's instruction format,
+// everything but instr_id and the STA, which depend on when the instruction enters the ROB
+uint32_t O3_CPU::fill_decode_batch()
+{
+    size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+
+    raw_batch.resize(DECODE_BATCH * instr_size);
+    decode_count = trace_file->read(raw_batch.data(), instr_size, DECODE_BATCH);
+    decode_pos = 0;
+
+    for (uint32_t n=0; n<decode_count; n++) {
+        ooo_model_instr &arch_instr = decode_batch[n];
+        int num_reg_ops = 0, num_mem_ops = 0;
+
+        if (knob_cloudsuite) {
+            cloudsuite_instr *instr = (cloudsuite_instr *)&raw_batch[n*instr_size];
+
+            arch_instr.ip = instr->ip;
+            arch_instr.is_branch = instr->is_branch;
+            arch_instr.branch_taken = instr->branch_taken;
+
+            arch_instr.asid[0] = instr->asid[0];
+            arch_instr.asid[1] = instr->asid[1];
+
+            for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+                arch_instr.destination_registers[i] = instr->destination_registers[i];
+                arch_instr.destination_memory[i] = instr->destination_memory[i];
+                arch_instr.destination_virtual_address[i] = instr->destination_memory[i];
+            }
+
+            for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+                arch_instr.source_registers[i] = instr->source_registers[i];
+                arch_instr.source_memory[i] = instr->source_memory[i];
+                arch_instr.source_virtual_address[i] = instr->source_memory[i];
+            }
+        }
+        else {
+            input_instr *instr = (input_instr *)&raw_batch[n*instr_size];
+
+            arch_instr.ip = instr->ip;
+            arch_instr.is_branch = instr->is_branch;
+            arch_instr.branch_taken = instr->branch_taken;
+
+            arch_instr.asid[0] = cpu;
+            arch_instr.asid[1] = cpu;
+
+            for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+                arch_instr.destination_registers[i] = instr->destination_registers[i];
+                arch_instr.destination_memory[i] = instr->destination_memory[i];
+                arch_instr.destination_virtual_address[i] = instr->destination_memory[i];
+            }
+
+            for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+                arch_instr.source_registers[i] = instr->source_registers[i];
+                arch_instr.source_memory[i] = instr->source_memory[i];
+                arch_instr.source_virtual_address[i] = instr->source_memory[i];
+            }
+        }
+
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (arch_instr.destination_registers[i])
+                num_reg_ops++;
+            if (arch_instr.destination_memory[i])
+                num_mem_ops++;
+        }
+
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+            if (arch_instr.source_registers[i])
+                num_reg_ops++;
+            if (arch_instr.source_memory[i])
+                num_mem_ops++;
+        }
+
+        arch_instr.num_reg_ops = num_reg_ops;
+        arch_instr.num_mem_ops = num_mem_ops;
+        arch_instr.is_memory = (num_mem_ops > 0);
+    }
+
+    return decode_count;
+}
+
+// read count records in program order, the rest of the decoded batch first
+uint64_t O3_CPU::read_trace(void *data, uint64_t count)
+{
+    size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+    uint64_t num_batched = decode_count - decode_pos;
+    if (num_batched > count)
+        num_batched = count;
+
+    if (num_batched) {
+        memcpy(data, &raw_batch[decode_pos*instr_size], num_batched*instr_size);
+        decode_pos += num_batched;
+    }
+    if (num_batched == count)
+        return count;
+
+    return num_batched + trace_file->read((uint8_t *)data + num_batched*instr_size, instr_size, count - num_batched);
+}
+
 void O3_CPU::handle_branch()
 {
     // actual processors do not work like this but for easier implementation,
@@ -24,270 +123,482 @@ void O3_CPU::handle_branch()
     // first, read PIN trace
     while (continue_reading) {
 
-        size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+        if ((decode_pos == decode_count) && (fill_decode_batch() == 0)) {
+            // reached end of file for this trace
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
 
-        if (knob_cloudsuite) {
-            if (!fread(&current_cloudsuite_instr, instr_size, 1, trace_file)) {
-                // reached end of file for this trace
-                cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+            // start the trace over 
+
+            trace_file->restart();
+            continue;
+        }
+
+        // the record was converted when its batch was read, add_to_rob() copies it as it is
+        ooo_model_instr &arch_instr = decode_batch[decode_pos++];
+        arch_instr.instr_id = instr_unique_id;
 
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (arch_instr.destination_memory[i]) {
+                // update STA, this structure is required to execute store instructios properly without deadlock
+#ifdef SANITY_CHECK
+                if (STA[STA_tail] < UINT64_MAX) {
+                    if (STA_head != STA_tail)
+                        assert(0);
                 }
-            } else { // successfully read the trace
+#endif
+                STA[STA_tail] = instr_unique_id;
+                STA_tail++;
 
-                // copy the instruction into the performance model's instruction format
-                ooo_model_instr arch_instr;
-                int num_reg_ops = 0, num_mem_ops = 0;
+                if (STA_tail == STA_SIZE)
+                    STA_tail = 0;
+            }
+        }
 
-                arch_instr.instr_id = instr_unique_id;
-                arch_instr.ip = current_cloudsuite_instr.ip;
-                arch_instr.is_branch = current_cloudsuite_instr.is_branch;
-                arch_instr.branch_taken = current_cloudsuite_instr.branch_taken;
+        // virtually add this instruction to the ROB
+        if (ROB.occupancy < ROB.SIZE) {
+            uint32_t rob_index = add_to_rob(&arch_instr);
+            num_reads++;
 
-                arch_instr.asid[0] = current_cloudsuite_instr.asid[0];
-                arch_instr.asid[1] = current_cloudsuite_instr.asid[1];
+            // branch prediction
+            if (arch_instr.is_branch) {
 
-                for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
-                    arch_instr.destination_registers[i] = current_cloudsuite_instr.destination_registers[i];
-                    arch_instr.destination_memory[i] = current_cloudsuite_instr.destination_memory[i];
-                    arch_instr.destination_virtual_address[i] = current_cloudsuite_instr.destination_memory[i];
+                DP( if (warmup_complete[cpu]) {
+                cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
 
-                    if (arch_instr.destination_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.destination_memory[i]) {
-                        num_mem_ops++;
+                num_branch++;
 
-                        // update STA, this structure is required to execute store instructios properly without deadlock
-                        if (num_mem_ops > 0) {
-#ifdef SANITY_CHECK
-                            if (STA[STA_tail] < UINT64_MAX) {
-                                if (STA_head != STA_tail)
-                                    assert(0);
-                            }
-#endif
-                            STA[STA_tail] = instr_unique_id;
-                            STA_tail++;
+                /*
+                uint8_t branch_prediction;
+                // for faster simulation, force perfect prediction during the warmup
+                // note that branch predictor is still learning with real branch results
+                if (all_warmup_complete == 0)
+                    branch_prediction = arch_instr.branch_taken; 
+                else
+                    branch_prediction = predict_branch(arch_instr.ip);
+                */
+                uint8_t branch_prediction = predict_branch(arch_instr.ip);
+                
+                if (arch_instr.branch_taken != branch_prediction) {
+                    branch_mispredictions++;
 
-                            if (STA_tail == STA_SIZE)
-                                STA_tail = 0;
-                        }
+                    DP( if (warmup_complete[cpu]) {
+                    cout << "[BRANCH] MISPREDICTED instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
+                    cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
+
+                    // halt any further fetch this cycle
+                    instrs_to_read_this_cycle = 0;
+
+                    // and stall any additional fetches until the branch is executed
+                    fetch_stall = 1; 
+
+                    ROB.entry[rob_index].branch_mispredicted = 1;
+                }
+                else {
+                    if (branch_prediction == 1) {
+                        // if we are accurately predicting a branch to be taken, then we can't possibly fetch down that path this cycle,
+                        // so we have to wait until the next cycle to fetch those
+                        instrs_to_read_this_cycle = 0;
                     }
+
+                    DP( if (warmup_complete[cpu]) {
+                    cout << "[BRANCH] PREDICTED    instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
+                    cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
                 }
 
-                for (int i=0; i<NUM_INSTR_SOURCES; i++) {
-                    arch_instr.source_registers[i] = current_cloudsuite_instr.source_registers[i];
-                    arch_instr.source_memory[i] = current_cloudsuite_instr.source_memory[i];
-                    arch_instr.source_virtual_address[i] = current_cloudsuite_instr.source_memory[i];
+                last_branch_result(arch_instr.ip, arch_instr.branch_taken);
+            }
 
-                    if (arch_instr.source_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.source_memory[i])
-                        num_mem_ops++;
-                }
+            //if ((num_reads == FETCH_WIDTH) || (ROB.occupancy == ROB.SIZE))
+            if ((num_reads >= instrs_to_read_this_cycle) || (ROB.occupancy == ROB.SIZE))
+                continue_reading = 0;
+        }
+        instr_unique_id++;
+    }
 
-                arch_instr.num_reg_ops = num_reg_ops;
-                arch_instr.num_mem_ops = num_mem_ops;
-                if (num_mem_ops > 0) 
-                    arch_instr.is_memory = 1;
-
-                // virtually add this instruction to the ROB
-                if (ROB.occupancy < ROB.SIZE) {
-                    uint32_t rob_index = add_to_rob(&arch_instr);
-                    num_reads++;
-
-                    // branch prediction
-                    if (arch_instr.is_branch) {
-
-                        DP( if (warmup_complete[cpu]) {
-                        cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
-
-                        num_branch++;
-
-                        /*
-                        uint8_t branch_prediction;
-                        // for faster simulation, force perfect prediction during the warmup
-                        // note that branch predictor is still learning with real branch results
-                        if (all_warmup_complete == 0)
-                            branch_prediction = arch_instr.branch_taken; 
-                        else
-                            branch_prediction = predict_branch(arch_instr.ip);
-                        */
-                        uint8_t branch_prediction = predict_branch(arch_instr.ip);
-                        
-                        if (arch_instr.branch_taken != branch_prediction) {
-                            branch_mispredictions++;
-
-                            DP( if (warmup_complete[cpu]) {
-                            cout << "[BRANCH] MISPREDICTED instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
-                            cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
-
-                            // halt any further fetch this cycle
-                            instrs_to_read_this_cycle = 0;
-
-                            // and stall any additional fetches until the branch is executed
-                            fetch_stall = 1; 
-
-                            ROB.entry[rob_index].branch_mispredicted = 1;
-                        }
-                        else {
-                            if (branch_prediction == 1) {
-                                // if we are accurately predicting a branch to be taken, then we can't possibly fetch down that path this cycle,
-                                // so we have to wait until the next cycle to fetch those
-                                instrs_to_read_this_cycle = 0;
-                            }
-
-                            DP( if (warmup_complete[cpu]) {
-                            cout << "[BRANCH] PREDICTED    instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
-                            cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
-                        }
+    //instrs_to_fetch_this_cycle = num_reads;
+}
 
-                        last_branch_result(arch_instr.ip, arch_instr.branch_taken);
-                    }
+void O3_CPU::skip_trace(uint64_t num_skip, uint8_t translate)
+{
+    // read num_skip records without simulating them
+    // records are read in chunks, and with translate the page table still sees every page they touch
+    size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+
+    // nothing needs the records themselves: drop what is left of the decoded batch, then let the reader skip the rest
+    // (a seek on block traces)
+    if (translate == 0) {
+        uint64_t num_batched = ((decode_count - decode_pos) < num_skip) ? (decode_count - decode_pos) : num_skip;
+        decode_pos += num_batched;
+        num_skip -= num_batched;
+    }
+    while (num_skip && (translate == 0)) {
+        uint64_t num_read = trace_file->skip(num_skip * instr_size) / instr_size;
+        num_skip -= num_read;
+
+        if (num_skip) {
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+            trace_file->restart();
+        }
+    }
+
+    uint64_t chunk_size = 4096;
+    vector <uint8_t> buffer(chunk_size * instr_size);
+
+    while (num_skip) {
+        uint64_t num_to_read = (num_skip < chunk_size) ? num_skip : chunk_size;
+        uint64_t num_read = read_trace(buffer.data(), num_to_read);
+
+        for (uint64_t i=0; translate && (i<num_read); i++) {
+            if (knob_cloudsuite) {
+                cloudsuite_instr *instr = (cloudsuite_instr *)&buffer[i*instr_size];
+
+                va_to_pa(cpu, instr_unique_id, instr->ip, ((instr->ip >> LOG2_PAGE_SIZE) << 9) | (256 + instr->asid[0]));
+                for (uint32_t j=0; j<NUM_INSTR_DESTINATIONS_SPARC; j++) {
+                    if (instr->destination_memory[j])
+                        va_to_pa(cpu, instr_unique_id, instr->destination_memory[j], ((instr->destination_memory[j] >> LOG2_PAGE_SIZE) << 9) | instr->asid[1]);
+                }
+                for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+                    if (instr->source_memory[j])
+                        va_to_pa(cpu, instr_unique_id, instr->source_memory[j], ((instr->source_memory[j] >> LOG2_PAGE_SIZE) << 9) | instr->asid[1]);
+                }
+            }
+            else {
+                input_instr *instr = (input_instr *)&buffer[i*instr_size];
 
-                    //if ((num_reads == FETCH_WIDTH) || (ROB.occupancy == ROB.SIZE))
-                    if ((num_reads >= instrs_to_read_this_cycle) || (ROB.occupancy == ROB.SIZE))
-                        continue_reading = 0;
+                va_to_pa(cpu, instr_unique_id, instr->ip, instr->ip >> LOG2_PAGE_SIZE);
+                for (uint32_t j=0; j<NUM_INSTR_DESTINATIONS; j++) {
+                    if (instr->destination_memory[j])
+                        va_to_pa(cpu, instr_unique_id, instr->destination_memory[j], instr->destination_memory[j] >> LOG2_PAGE_SIZE);
+                }
+                for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+                    if (instr->source_memory[j])
+                        va_to_pa(cpu, instr_unique_id, instr->source_memory[j], instr->source_memory[j] >> LOG2_PAGE_SIZE);
                 }
-                instr_unique_id++;
             }
-        } else {
-            if (!fread(&current_instr, instr_size, 1, trace_file)) {
+        }
+
+        num_skip -= num_read;
+
+        if (num_read < num_to_read) {
+            // reached end of file for this trace
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+
+            // start the trace over 
+
+            trace_file->restart();
+        }
+    }
+}
+
+void O3_CPU::warm_trace(uint64_t num_warm)
+{
+    // functional warmup: num_warm records train the branch predictor and go through the TLBs and caches
+    // in program order, with no pipeline and no timing
+    while (num_warm) {
+        uint64_t ip, destination_memory[NUM_INSTR_DESTINATIONS_SPARC], source_memory[NUM_INSTR_SOURCES];
+        uint8_t is_branch, branch_taken, asid[2] = {0, 0};
+
+        if (knob_cloudsuite) {
+            if (!read_trace(&current_cloudsuite_instr, 1)) {
                 // reached end of file for this trace
                 cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
 
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
-            } else { // successfully read the trace
+                // start the trace over 
 
-                // copy the instruction into the performance model's instruction format
-                ooo_model_instr arch_instr;
-                int num_reg_ops = 0, num_mem_ops = 0;
+                trace_file->restart();
+                continue;
+            }
 
-                arch_instr.instr_id = instr_unique_id;
-                arch_instr.ip = current_instr.ip;
-                arch_instr.is_branch = current_instr.is_branch;
-                arch_instr.branch_taken = current_instr.branch_taken;
+            ip = current_cloudsuite_instr.ip;
+            is_branch = current_cloudsuite_instr.is_branch;
+            branch_taken = current_cloudsuite_instr.branch_taken;
+            asid[0] = current_cloudsuite_instr.asid[0];
+            asid[1] = current_cloudsuite_instr.asid[1];
+            for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+                destination_memory[i] = current_cloudsuite_instr.destination_memory[i];
+            for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+                source_memory[i] = current_cloudsuite_instr.source_memory[i];
+        }
+        else {
+            if (!read_trace(&current_instr, 1)) {
+                // reached end of file for this trace
+                cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
 
-                arch_instr.asid[0] = cpu;
-                arch_instr.asid[1] = cpu;
+                // start the trace over 
 
-                for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
-                    arch_instr.destination_registers[i] = current_instr.destination_registers[i];
-                    arch_instr.destination_memory[i] = current_instr.destination_memory[i];
-                    arch_instr.destination_virtual_address[i] = current_instr.destination_memory[i];
+                trace_file->restart();
+                continue;
+            }
 
-                    if (arch_instr.destination_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.destination_memory[i]) {
-                        num_mem_ops++;
+            ip = current_instr.ip;
+            is_branch = current_instr.is_branch;
+            branch_taken = current_instr.branch_taken;
+            for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+                destination_memory[i] = (i < NUM_INSTR_DESTINATIONS) ? current_instr.destination_memory[i] : 0;
+            for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+                source_memory[i] = current_instr.source_memory[i];
+        }
 
-                        // update STA, this structure is required to execute store instructios properly without deadlock
-                        if (num_mem_ops > 0) {
-#ifdef SANITY_CHECK
-                            if (STA[STA_tail] < UINT64_MAX) {
-                                if (STA_head != STA_tail)
-                                    assert(0);
-                            }
-#endif
-                            STA[STA_tail] = instr_unique_id;
-                            STA_tail++;
+        // instruction fetch
+        PACKET fetch_packet;
+        fetch_packet.instruction = 1;
+        fetch_packet.fill_level = FILL_L1;
+        fetch_packet.cpu = cpu;
+        if (knob_cloudsuite)
+            fetch_packet.address = ((ip >> LOG2_PAGE_SIZE) << 9) | (256 + asid[0]);
+        else
+            fetch_packet.address = ip >> LOG2_PAGE_SIZE;
+        fetch_packet.full_addr = ip;
+        fetch_packet.instr_id = instr_unique_id;
+        fetch_packet.ip = ip;
+        fetch_packet.type = LOAD;
+        fetch_packet.asid[0] = asid[0];
+        fetch_packet.asid[1] = asid[1];
+
+        ITLB.warm_access(&fetch_packet);
+
+        fetch_packet.instruction_pa = (fetch_packet.data << LOG2_PAGE_SIZE) | (ip & ((1 << LOG2_PAGE_SIZE) - 1));
+        fetch_packet.address = fetch_packet.instruction_pa >> LOG2_BLOCK_SIZE;
+        fetch_packet.full_addr = fetch_packet.instruction_pa;
+        fetch_packet.data = 0;
+
+        L1I.warm_access(&fetch_packet);
+
+        // branch prediction
+        if (is_branch) {
+            predict_branch(ip);
+            last_branch_result(ip, branch_taken);
+        }
 
-                            if (STA_tail == STA_SIZE)
-                                STA_tail = 0;
-                        }
-                    }
-                }
+        // loads first, then stores, as they leave the LSQ
+        for (uint32_t i=0; i<(NUM_INSTR_SOURCES + NUM_INSTR_DESTINATIONS_SPARC); i++) {
+            uint64_t virtual_address = (i < NUM_INSTR_SOURCES) ? source_memory[i] : destination_memory[i - NUM_INSTR_SOURCES];
+            if (virtual_address == 0)
+                continue;
 
-                for (int i=0; i<NUM_INSTR_SOURCES; i++) {
-                    arch_instr.source_registers[i] = current_instr.source_registers[i];
-                    arch_instr.source_memory[i] = current_instr.source_memory[i];
-                    arch_instr.source_virtual_address[i] = current_instr.source_memory[i];
+            PACKET data_packet;
+            data_packet.fill_level = FILL_L1;
+            data_packet.cpu = cpu;
+            if (knob_cloudsuite)
+                data_packet.address = ((virtual_address >> LOG2_PAGE_SIZE) << 9) | asid[1];
+            else
+                data_packet.address = virtual_address >> LOG2_PAGE_SIZE;
+            data_packet.full_addr = virtual_address;
+            data_packet.instr_id = instr_unique_id;
+            data_packet.ip = ip;
+            data_packet.type = (i < NUM_INSTR_SOURCES) ? LOAD : RFO;
+            data_packet.asid[0] = asid[0];
+            data_packet.asid[1] = asid[1];
+
+            DTLB.warm_access(&data_packet);
+
+            uint64_t physical_address = (data_packet.data << LOG2_PAGE_SIZE) | (virtual_address & ((1 << LOG2_PAGE_SIZE) - 1));
+            data_packet.address = physical_address >> LOG2_BLOCK_SIZE;
+            data_packet.full_addr = physical_address;
+            data_packet.data = 0;
+
+            L1D.warm_access(&data_packet);
+        }
 
-                    if (arch_instr.source_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.source_memory[i])
-                        num_mem_ops++;
-                }
+        instr_unique_id++;
+        num_warm--;
+    }
+}
 
-                arch_instr.num_reg_ops = num_reg_ops;
-                arch_instr.num_mem_ops = num_mem_ops;
-                if (num_mem_ops > 0) 
-                    arch_instr.is_memory = 1;
-
-                // virtually add this instruction to the ROB
-                if (ROB.occupancy < ROB.SIZE) {
-                    uint32_t rob_index = add_to_rob(&arch_instr);
-                    num_reads++;
-
-                    // branch prediction
-                    if (arch_instr.is_branch) {
-
-                        DP( if (warmup_complete[cpu]) {
-                        cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
-
-                        num_branch++;
-
-                        /*
-                        uint8_t branch_prediction;
-                        // for faster simulation, force perfect prediction during the warmup
-                        // note that branch predictor is still learning with real branch results
-                        if (all_warmup_complete == 0)
-                            branch_prediction = arch_instr.branch_taken; 
-                        else
-                            branch_prediction = predict_branch(arch_instr.ip);
-                        */
-                        uint8_t branch_prediction = predict_branch(arch_instr.ip);
-                        
-                        if (arch_instr.branch_taken != branch_prediction) {
-                            branch_mispredictions++;
-
-                            DP( if (warmup_complete[cpu]) {
-                            cout << "[BRANCH] MISPREDICTED instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
-                            cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
-
-                            // halt any further fetch this cycle
-                            instrs_to_read_this_cycle = 0;
-
-                            // and stall any additional fetches until the branch is executed
-                            fetch_stall = 1; 
-
-                            ROB.entry[rob_index].branch_mispredicted = 1;
-                        }
-                        else {
-                            if (branch_prediction == 1) {
-                                // if we are accurately predicting a branch to be taken, then we can't possibly fetch down that path this cycle,
-                                // so we have to wait until the next cycle to fetch those
-                                instrs_to_read_this_cycle = 0;
-                            }
-
-                            DP( if (warmup_complete[cpu]) {
-                            cout << "[BRANCH] PREDICTED    instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec;
-                            cout << " taken: " << +arch_instr.branch_taken << " predicted: " << +branch_prediction << endl; });
-                        }
+// -memory_only: one cycle of a core that only does the trace's loads and stores, in place of the pipeline.
+// up to FETCH_WIDTH instructions a cycle enter an in-order window of ROB_SIZE and their loads go to the L1D right away,
+// at most LQ_SIZE of them in flight. dispatch stops at a load whose address registers come from a load still in flight,
+// and instructions retire RETIRE_WIDTH a cycle once their loads are back, sending their stores to the L1D as retire_rob() does.
+// addresses are translated with the TLBs functionally, see translate_data()
+void O3_CPU::operate_memory_only()
+{
+    // loads the L1D is done with, loads merged into a miss come back with it
+    while (L1D.PROCESSED.occupancy && (L1D.PROCESSED.entry[L1D.PROCESSED.head].event_cycle <= current_core_cycle[cpu])) {
+        PACKET *packet = &L1D.PROCESSED.entry[L1D.PROCESSED.head];
+        if (packet->type != RFO)
+            complete_memory_load(packet->lq_index);
+        ITERATE_SET(merged, packet->lq_index_depend_on_me, LQ_SIZE)
+            complete_memory_load(merged);
+        L1D.PROCESSED.remove_queue(packet);
+    }
 
-                        last_branch_result(arch_instr.ip, arch_instr.branch_taken);
-                    }
+    // retire
+    for (uint32_t n=0; (n<RETIRE_WIDTH) && memory_window_occupancy; n++) {
+        MEMORY_WINDOW_ENTRY &entry = memory_window[memory_window_head];
+        if (entry.pending_loads)
+            break;
 
-                    //if ((num_reads == FETCH_WIDTH) || (ROB.occupancy == ROB.SIZE))
-                    if ((num_reads >= instrs_to_read_this_cycle) || (ROB.occupancy == ROB.SIZE))
-                        continue_reading = 0;
-                }
-                instr_unique_id++;
-            }
+        uint32_t num_store = 0;
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++) {
+            if (entry.store[i])
+                num_store++;
         }
+        if ((L1D.WQ.occupancy + num_store) > L1D.WQ.SIZE) {
+            L1D.WQ.FULL++;
+            L1D.STALL[RFO]++;
+            break;
+        }
+
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++) {
+            if (entry.store[i] == 0)
+                continue;
+
+            PACKET data_packet;
+            data_packet.fill_level = FILL_L1;
+            data_packet.cpu = cpu;
+            data_packet.address = entry.store[i] >> LOG2_BLOCK_SIZE;
+            data_packet.full_addr = entry.store[i];
+            data_packet.instr_id = entry.instr_id;
+            data_packet.rob_index = memory_window_head;
+            data_packet.ip = entry.ip;
+            data_packet.type = RFO;
+            data_packet.asid[0] = entry.asid[0];
+            data_packet.asid[1] = entry.asid[1];
+            data_packet.event_cycle = current_core_cycle[cpu];
+
+            L1D.add_wq(&data_packet);
+        }
+
+        memory_window_head++;
+        if (memory_window_head == ROB_SIZE)
+            memory_window_head = 0;
+        memory_window_occupancy--;
+        num_retired++;
     }
 
-    //instrs_to_fetch_this_cycle = num_reads;
+    // dispatch, an instruction waits until all of its loads can go to the L1D
+    for (uint32_t n=0; (n<FETCH_WIDTH) && (memory_window_occupancy < ROB_SIZE) && (stall_cycle[cpu] <= current_core_cycle[cpu]); n++) {
+        if ((decode_pos == decode_count) && (fill_decode_batch() == 0)) {
+            // reached end of file for this trace
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+
+            // start the trace over 
+
+            trace_file->restart();
+            n--;
+            continue;
+        }
+
+        ooo_model_instr &arch_instr = decode_batch[decode_pos];
+        uint32_t num_loads = 0;
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+            if (arch_instr.source_memory[i])
+                num_loads++;
+        }
+        if ((num_loads > memory_free_loads) || ((L1D.RQ.occupancy + num_loads) > L1D.RQ.SIZE))
+            break;
+
+        // the newest load in flight that a source register comes from
+        uint64_t depends_on = UINT64_MAX;
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+            uint64_t producer = memory_register_load[arch_instr.source_registers[i]];
+            if (arch_instr.source_registers[i] && memory_load_pending(producer) && ((depends_on == UINT64_MAX) || (producer > depends_on)))
+                depends_on = producer;
+        }
+        if (num_loads && (depends_on != UINT64_MAX))
+            break;
+        decode_pos++;
+
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (arch_instr.destination_registers[i])
+                memory_register_load[arch_instr.destination_registers[i]] = num_loads ? instr_unique_id : depends_on;
+        }
+
+        uint32_t window_index = memory_window_head + memory_window_occupancy;
+        if (window_index >= ROB_SIZE)
+            window_index -= ROB_SIZE;
+        MEMORY_WINDOW_ENTRY &entry = memory_window[window_index];
+        entry.ip = arch_instr.ip;
+        entry.instr_id = instr_unique_id;
+        entry.asid[0] = arch_instr.asid[0];
+        entry.asid[1] = arch_instr.asid[1];
+        entry.pending_loads = 0;
+        memory_window_occupancy++;
+
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++) {
+            uint64_t virtual_address = (i < MAX_INSTR_DESTINATIONS) ? arch_instr.destination_memory[i] : 0;
+            entry.store[i] = virtual_address ? translate_data(&arch_instr, virtual_address) : 0;
+        }
+
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+            uint64_t virtual_address = arch_instr.source_memory[i];
+            if (virtual_address == 0)
+                continue;
+
+            uint32_t load = 0;
+            while (memory_load_window[load] != UINT32_MAX)
+                load++;
+
+            uint64_t physical_address = translate_data(&arch_instr, virtual_address);
+
+            PACKET data_packet;
+            data_packet.fill_level = FILL_L1;
+            data_packet.cpu = cpu;
+            data_packet.lq_index = load;
+            data_packet.address = physical_address >> LOG2_BLOCK_SIZE;
+            data_packet.full_addr = physical_address;
+            data_packet.instr_id = instr_unique_id;
+            data_packet.rob_index = window_index;
+            data_packet.ip = arch_instr.ip;
+            data_packet.type = LOAD;
+            data_packet.asid[0] = arch_instr.asid[0];
+            data_packet.asid[1] = arch_instr.asid[1];
+            data_packet.event_cycle = current_core_cycle[cpu];
+
+            L1D.add_rq(&data_packet);
+
+            memory_load_window[load] = window_index;
+            memory_free_loads--;
+            entry.pending_loads++;
+        }
+
+        instr_unique_id++;
+    }
+
+    operate_cache();
+}
+
+// translation without timing: the DTLB and STLB are looked up and filled as in warm_trace(),
+// so only STLB misses cost anything, the page walk stall of va_to_pa()
+uint64_t O3_CPU::translate_data(ooo_model_instr *arch_instr, uint64_t virtual_address)
+{
+    PACKET translation;
+    translation.fill_level = FILL_L1;
+    translation.cpu = cpu;
+    if (knob_cloudsuite)
+        translation.address = ((virtual_address >> LOG2_PAGE_SIZE) << 9) | arch_instr->asid[1];
+    else
+        translation.address = virtual_address >> LOG2_PAGE_SIZE;
+    translation.full_addr = virtual_address;
+    translation.instr_id = instr_unique_id;
+    translation.ip = arch_instr->ip;
+    translation.type = LOAD;
+    translation.asid[0] = arch_instr->asid[0];
+    translation.asid[1] = arch_instr->asid[1];
+
+    DTLB.warm_access(&translation);
+
+    return (translation.data << LOG2_PAGE_SIZE) | (virtual_address & ((1 << LOG2_PAGE_SIZE) - 1));
+}
+
+// 1 while instruction instr_id is in the window and waits for a load
+int O3_CPU::memory_load_pending(uint64_t instr_id)
+{
+    if ((memory_window_occupancy == 0) || (instr_id == UINT64_MAX) || (instr_id < memory_window[memory_window_head].instr_id))
+        return 0;
+
+    // the window holds consecutive instructions
+    uint64_t index = memory_window_head + (instr_id - memory_window[memory_window_head].instr_id);
+    if (index >= ROB_SIZE)
+        index -= ROB_SIZE;
+    return (memory_window[index].pending_loads > 0);
+}
+
+void O3_CPU::complete_memory_load(uint32_t load)
+{
+    memory_window[memory_load_window[load]].pending_loads--;
+    memory_load_window[load] = UINT32_MAX;
+    memory_free_loads++;
 }
 
 uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
@@ -302,7 +613,18 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
     }
 
     ROB.entry[index] = *arch_instr;
-    ROB.entry[index].event_cycle = current_core_cycle[cpu];
+    ROB.event_cycle[index] = current_core_cycle[cpu];
+
+    // rename, the sources read the producers in the RAT before this instruction becomes the producer of its destinations
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+        RAT_source[index][i] = ROB.entry[index].source_registers[i] ? RAT[ROB.entry[index].source_registers[i]] : ROB_SIZE;
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[index].destination_registers[i])
+            RAT[ROB.entry[index].destination_registers[i]] = index;
+    }
+
+    if (ROB.entry[index].is_memory)
+        add_store_address(index);
 
     ROB.occupancy++;
     ROB.tail++;
@@ -313,7 +635,7 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
     cout << "[ROB] " <<  __func__ << " instr_id: " << ROB.entry[index].instr_id;
     cout << " ip: " << hex << ROB.entry[index].ip << dec;
     cout << " head: " << ROB.head << " tail: " << ROB.tail << " occupancy: " << ROB.occupancy;
-    cout << " event: " << ROB.entry[index].event_cycle << " current: " << current_core_cycle[cpu] << endl; });
+    cout << " event: " << ROB.event_cycle[index] << " current: " << current_core_cycle[cpu] << endl; });
 
 #ifdef SANITY_CHECK
     if (ROB.entry[index].ip == 0) {
@@ -331,32 +653,18 @@ uint32_t O3_CPU::check_rob(uint64_t instr_id)
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return ROB.SIZE;
 
-    if (ROB.head < ROB.tail) {
-        for (uint32_t i=ROB.head; i<ROB.tail; i++) {
-            if (ROB.entry[i].instr_id == instr_id) {
-                DP ( if (warmup_complete[ROB.cpu]) {
-                cout << "[ROB] " << __func__ << " same instr_id: " << ROB.entry[i].instr_id;
-                cout << " rob_index: " << i << endl; });
-                return i;
-            }
-        }
-    }
-    else {
-        for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
-            if (ROB.entry[i].instr_id == instr_id) {
-                DP ( if (warmup_complete[cpu]) {
-                cout << "[ROB] " << __func__ << " same instr_id: " << ROB.entry[i].instr_id;
-                cout << " rob_index: " << i << endl; });
-                return i;
-            }
-        }
-        for (uint32_t i=0; i<ROB.tail; i++) {
-            if (ROB.entry[i].instr_id == instr_id) {
-                DP ( if (warmup_complete[cpu]) {
-                cout << "[ROB] " << __func__ << " same instr_id: " << ROB.entry[i].instr_id;
-                cout << " rob_index: " << i << endl; });
-                return i;
-            }
+    // instr_ids enter the ROB one after another, so an instruction is as far from the head as its instr_id is from the head's
+    uint64_t distance = instr_id - ROB.entry[ROB.head].instr_id;
+    if ((instr_id >= ROB.entry[ROB.head].instr_id) && (distance < ROB.occupancy)) {
+        uint32_t i = ROB.head + distance;
+        if (i >= ROB.SIZE)
+            i -= ROB.SIZE;
+
+        if (ROB.entry[i].instr_id == instr_id) {
+            DP ( if (warmup_complete[cpu]) {
+            cout << "[ROB] " << __func__ << " same instr_id: " << ROB.entry[i].instr_id;
+            cout << " rob_index: " << i << endl; });
+            return i;
         }
     }
 
@@ -380,7 +688,7 @@ void O3_CPU::fetch_instruction()
 
 #ifdef SANITY_CHECK
         // sanity check
-        if (ROB.entry[read_index].translated) {
+        if (ROB.translated[read_index]) {
             if (read_index == ROB.head)
                 break;
             else {
@@ -438,11 +746,11 @@ void O3_CPU::fetch_instruction()
     for (uint32_t i=0; i<FETCH_WIDTH; i++) {
 
         // fetch is in-order so it should be break
-        if ((ROB.entry[fetch_index].translated != COMPLETED) || (ROB.entry[fetch_index].event_cycle > current_core_cycle[cpu])) 
+        if ((ROB.translated[fetch_index] != COMPLETED) || (ROB.event_cycle[fetch_index] > current_core_cycle[cpu])) 
             break;
 
         // sanity check
-        if (ROB.entry[fetch_index].fetched) {
+        if (ROB.fetched[fetch_index]) {
             if (fetch_index == ROB.head)
                 break;
             else {
@@ -484,7 +792,7 @@ void O3_CPU::fetch_instruction()
             }
             */
 
-            ROB.entry[fetch_index].fetched = INFLIGHT;
+            ROB.fetched[fetch_index] = INFLIGHT;
             ROB.last_fetch = fetch_index;
             fetch_index++;
             if (fetch_index == ROB.SIZE)
@@ -507,10 +815,10 @@ void O3_CPU::schedule_instruction()
     num_searched = 0;
     if (ROB.head < limit) {
         for (uint32_t i=ROB.head; i<limit; i++) { 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 return;
 
-            if (ROB.entry[i].scheduled == 0)
+            if (ROB.scheduled[i] == 0)
                 do_scheduling(i);
 
             num_searched++;
@@ -518,19 +826,19 @@ void O3_CPU::schedule_instruction()
     }
     else {
         for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 return;
 
-            if (ROB.entry[i].scheduled == 0)
+            if (ROB.scheduled[i] == 0)
                 do_scheduling(i);
 
             num_searched++;
         }
         for (uint32_t i=0; i<limit; i++) { 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 return;
 
-            if (ROB.entry[i].scheduled == 0)
+            if (ROB.scheduled[i] == 0)
                 do_scheduling(i);
 
             num_searched++;
@@ -540,23 +848,23 @@ void O3_CPU::schedule_instruction()
 
 void O3_CPU::do_scheduling(uint32_t rob_index)
 {
-    ROB.entry[rob_index].reg_ready = 1; // reg_ready will be reset to 0 if there is RAW dependency 
+    ROB.reg_ready[rob_index] = 1; // reg_ready will be reset to 0 if there is RAW dependency 
 
     reg_dependency(rob_index);
     ROB.next_schedule = (rob_index == (ROB.SIZE - 1)) ? 0 : (rob_index + 1);
 
     if (ROB.entry[rob_index].is_memory)
-        ROB.entry[rob_index].scheduled = INFLIGHT;
+        ROB.scheduled[rob_index] = INFLIGHT;
     else {
-        ROB.entry[rob_index].scheduled = COMPLETED;
+        ROB.scheduled[rob_index] = COMPLETED;
 
         // ADD LATENCY
-        if (ROB.entry[rob_index].event_cycle < current_core_cycle[cpu])
-            ROB.entry[rob_index].event_cycle = current_core_cycle[cpu] + SCHEDULING_LATENCY;
+        if (ROB.event_cycle[rob_index] < current_core_cycle[cpu])
+            ROB.event_cycle[rob_index] = current_core_cycle[cpu] + SCHEDULING_LATENCY;
         else
-            ROB.entry[rob_index].event_cycle += SCHEDULING_LATENCY;
+            ROB.event_cycle[rob_index] += SCHEDULING_LATENCY;
 
-        if (ROB.entry[rob_index].reg_ready) {
+        if (ROB.reg_ready[rob_index]) {
 
 #ifdef SANITY_CHECK
             if (RTE1[RTE1_tail] < ROB_SIZE)
@@ -594,32 +902,16 @@ void O3_CPU::reg_dependency(uint32_t rob_index)
     } }); 
 
     // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
+    // a source depends on its producer from the RAT while the producer has not completed,
+    // a producer that is no longer ahead of this instruction in the ROB has retired
+    uint32_t age = (rob_index + ROB.SIZE - ROB.head) % ROB.SIZE;
+    for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+        uint32_t prior = RAT_source[rob_index][j];
+        if ((prior == ROB_SIZE) || (ROB.entry[rob_index].reg_RAW_checked[j]))
+            continue;
 
-    if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-        } else {
-            for (int i=prior; i>=0; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-        }
+        if ((((prior + ROB.SIZE - ROB.head) % ROB.SIZE) < age) && (ROB.executed[prior] != COMPLETED))
+            reg_RAW_dependency(prior, rob_index, j);
     }
 }
 
@@ -636,7 +928,7 @@ void O3_CPU::reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t sourc
             ROB.entry[prior].registers_index_depend_on_me[source_index].insert (current);   // this load cannot be executed until the prior store gets executed
             ROB.entry[prior].reg_RAW_producer = 1;
 
-            ROB.entry[current].reg_ready = 0;
+            ROB.reg_ready[current] = 0;
             ROB.entry[current].producer_id = ROB.entry[prior].instr_id; 
             ROB.entry[current].num_reg_dependent++;
             ROB.entry[current].reg_RAW_checked[source_index] = 1;
@@ -663,7 +955,7 @@ void O3_CPU::execute_instruction()
     while (exec_issued < EXEC_WIDTH) {
         if (RTE0[RTE0_head] < ROB_SIZE) {
             uint32_t exec_index = RTE0[RTE0_head];
-            if (ROB.entry[exec_index].event_cycle <= current_core_cycle[cpu]) {
+            if (ROB.event_cycle[exec_index] <= current_core_cycle[cpu]) {
                 do_execution(exec_index);
 
                 RTE0[RTE0_head] = ROB_SIZE;
@@ -688,7 +980,7 @@ void O3_CPU::execute_instruction()
     while (exec_issued < EXEC_WIDTH) {
         if (RTE1[RTE1_head] < ROB_SIZE) {
             uint32_t exec_index = RTE1[RTE1_head];
-            if (ROB.entry[exec_index].event_cycle <= current_core_cycle[cpu]) {
+            if (ROB.event_cycle[exec_index] <= current_core_cycle[cpu]) {
                 do_execution(exec_index);
 
                 RTE1[RTE1_head] = ROB_SIZE;
@@ -712,21 +1004,22 @@ void O3_CPU::execute_instruction()
 
 void O3_CPU::do_execution(uint32_t rob_index)
 {
-    //if (ROB.entry[rob_index].reg_ready && (ROB.entry[rob_index].scheduled == COMPLETED) && (ROB.entry[rob_index].event_cycle <= current_core_cycle[cpu])) {
+    //if (ROB.reg_ready[rob_index] && (ROB.scheduled[rob_index] == COMPLETED) && (ROB.event_cycle[rob_index] <= current_core_cycle[cpu])) {
 
-        ROB.entry[rob_index].executed = INFLIGHT;
+        ROB.executed[rob_index] = INFLIGHT;
 
         // ADD LATENCY
-        if (ROB.entry[rob_index].event_cycle < current_core_cycle[cpu])
-            ROB.entry[rob_index].event_cycle = current_core_cycle[cpu] + EXEC_LATENCY;
+        if (ROB.event_cycle[rob_index] < current_core_cycle[cpu])
+            ROB.event_cycle[rob_index] = current_core_cycle[cpu] + EXEC_LATENCY;
         else
-            ROB.entry[rob_index].event_cycle += EXEC_LATENCY;
+            ROB.event_cycle[rob_index] += EXEC_LATENCY;
 
         inflight_reg_executions++;
+        add_completion(rob_index);
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " non-memory instr_id: " << ROB.entry[rob_index].instr_id; 
-        cout << " event_cycle: " << ROB.entry[rob_index].event_cycle << endl;});
+        cout << " event_cycle: " << ROB.event_cycle[rob_index] << endl;});
     //}
 }
 
@@ -744,10 +1037,10 @@ void O3_CPU::schedule_memory_instruction()
             if (ROB.entry[i].is_memory == 0)
                 continue;
 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 break;
 
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
+            if (ROB.entry[i].is_memory && ROB.reg_ready[i] && (ROB.scheduled[i] == INFLIGHT))
                 do_memory_scheduling(i);
         }
     }
@@ -757,10 +1050,10 @@ void O3_CPU::schedule_memory_instruction()
             if (ROB.entry[i].is_memory == 0)
                 continue;
 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 break;
 
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
+            if (ROB.entry[i].is_memory && ROB.reg_ready[i] && (ROB.scheduled[i] == INFLIGHT))
                 do_memory_scheduling(i);
         }
         for (uint32_t i=0; i<limit; i++) {
@@ -768,10 +1061,10 @@ void O3_CPU::schedule_memory_instruction()
             if (ROB.entry[i].is_memory == 0)
                 continue;
 
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
+            if ((ROB.fetched[i] != COMPLETED) || (ROB.event_cycle[i] > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 break;
 
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
+            if (ROB.entry[i].is_memory && ROB.reg_ready[i] && (ROB.scheduled[i] == INFLIGHT))
                 do_memory_scheduling(i);
         }
     }
@@ -787,9 +1080,10 @@ void O3_CPU::do_memory_scheduling(uint32_t rob_index)
 {
     uint32_t not_available = check_and_add_lsq(rob_index);
     if (not_available == 0) {
-        ROB.entry[rob_index].scheduled = COMPLETED;
-        if (ROB.entry[rob_index].executed == 0) // it could be already set to COMPLETED due to store-to-load forwarding
-            ROB.entry[rob_index].executed  = INFLIGHT;
+        ROB.scheduled[rob_index] = COMPLETED;
+        if (ROB.executed[rob_index] == 0) // it could be already set to COMPLETED due to store-to-load forwarding
+            ROB.executed[rob_index]  = INFLIGHT;
+        add_completion(rob_index);
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " rob_index: " << rob_index;
@@ -857,11 +1151,12 @@ uint32_t O3_CPU::check_and_add_lsq(uint32_t rob_index)
 
 void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
 {
-    // search for an empty slot 
+    // take the lowest free slot
     uint32_t lq_index = LQ.SIZE;
-    for (uint32_t i=0; i<LQ.SIZE; i++) {
-        if (LQ.entry[i].virtual_address == 0) {
-            lq_index = i;
+    for (uint32_t i=0; i<(LQ_SIZE+63)/64; i++) {
+        if (LQ_free[i]) {
+            lq_index = i*64 + __builtin_ctzll(LQ_free[i]);
+            LQ_free[i] &= LQ_free[i] - 1;
             break;
         }
     }
@@ -885,31 +1180,16 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
     LQ.occupancy++;
 
     // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
-
+    // the producer is the youngest store to this address that is older than the load
+    uint64_t load_address = LQ.entry[lq_index].virtual_address;
+    uint32_t producer = ROB.SIZE;
     if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-        }
-        else {
-            for (int i=prior; i>=0; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) { 
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
+        for (uint32_t n=store_table[store_address_set(load_address)]; n!=UINT32_MAX; n=store_table_next[n]) {
+            uint32_t prior = n / NUM_INSTR_DESTINATIONS_SPARC;
+            if ((ROB.entry[prior].instr_id < LQ.entry[lq_index].instr_id) && (ROB.entry[prior].destination_memory[n % NUM_INSTR_DESTINATIONS_SPARC] == load_address)) {
+                mem_RAW_dependency(prior, rob_index, data_index, lq_index);
+                producer = prior;
+                break;
             }
         }
     }
@@ -918,45 +1198,50 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
     // 1) if store-to-load forwarding is possible
     // 2) if there is WAR that are not correctly executed
     uint32_t forwarding_index = SQ.SIZE;
-    for (uint32_t i=0; i<SQ.SIZE; i++) {
-
-        // skip empty slot
-        if (SQ.entry[i].virtual_address == 0)
-            continue;
-
+    if (producer != ROB.SIZE) {
         // forwarding should be done by the SQ entry that holds the same producer_id from RAW dependency check
-        if (SQ.entry[i].virtual_address == LQ.entry[lq_index].virtual_address) { // store-to-load forwarding check
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            uint32_t sq_index = ROB.entry[producer].sq_index[i];
+            if ((ROB.entry[producer].destination_memory[i] == load_address) && (sq_index < forwarding_index)) // RAW
+                forwarding_index = sq_index;
+        }
+    }
+    else {
+        for (uint32_t n=store_table[store_address_set(load_address)]; n!=UINT32_MAX; n=store_table_next[n]) {
+            uint32_t later = n / NUM_INSTR_DESTINATIONS_SPARC,
+                     sq_index = ROB.entry[later].sq_index[n % NUM_INSTR_DESTINATIONS_SPARC];
 
-            // forwarding store is in the SQ
-            if ((rob_index != ROB.head) && (LQ.entry[lq_index].producer_id == SQ.entry[i].instr_id)) { // RAW
-                forwarding_index = i;
-                break; // should be break
-            }
+            // the stores are youngest first, the rest are logically earlier than the load
+            if (ROB.entry[later].instr_id < LQ.entry[lq_index].instr_id)
+                break;
 
-            if ((LQ.entry[lq_index].producer_id == UINT64_MAX) && (LQ.entry[lq_index].instr_id <= SQ.entry[i].instr_id)) { // WAR 
-                // a load is about to be added in the load queue and we found a store that is 
-                // "logically later in the program order but already executed" => this is not correctly executed WAR
-                // due to out-of-order execution, this case is possible, for example
-                // 1) application is load intensive and load queue is full
-                // 2) we have loads that can't be added in the load queue
-                // 3) subsequent stores logically behind in the program order are added in the store queue first
-
-                // thanks to the store buffer, data is not written back to the memory system until retirement
-                // also due to in-order retirement, this "already executed store" cannot be retired until we finish the prior load instruction 
-                // if we detect WAR when a load is added in the load queue, just let the load instruction to access the memory system
-                // no need to mark any dependency because this is actually WAR not RAW
-
-                // do not forward data from the store queue since this is WAR
-                // just read correct data from data cache
-
-                LQ.entry[lq_index].physical_address = 0;
-                LQ.entry[lq_index].translated = 0;
-                LQ.entry[lq_index].fetched = 0;
-                
-                DP(if(warmup_complete[cpu]) {
-                cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << " reset fetched: " << +LQ.entry[lq_index].fetched;
-                cout << " to obey WAR store instr_id: " << SQ.entry[i].instr_id << " cycle: " << current_core_cycle[cpu] << endl; });
-            }
+            // skip stores that are not in the SQ yet
+            if ((sq_index == UINT32_MAX) || (SQ.entry[sq_index].virtual_address != load_address))
+                continue;
+
+            // WAR 
+            // a load is about to be added in the load queue and we found a store that is 
+            // "logically later in the program order but already executed" => this is not correctly executed WAR
+            // due to out-of-order execution, this case is possible, for example
+            // 1) application is load intensive and load queue is full
+            // 2) we have loads that can't be added in the load queue
+            // 3) subsequent stores logically behind in the program order are added in the store queue first
+
+            // thanks to the store buffer, data is not written back to the memory system until retirement
+            // also due to in-order retirement, this "already executed store" cannot be retired until we finish the prior load instruction 
+            // if we detect WAR when a load is added in the load queue, just let the load instruction to access the memory system
+            // no need to mark any dependency because this is actually WAR not RAW
+
+            // do not forward data from the store queue since this is WAR
+            // just read correct data from data cache
+
+            LQ.entry[lq_index].physical_address = 0;
+            LQ.entry[lq_index].translated = 0;
+            LQ.entry[lq_index].fetched = 0;
+            
+            DP(if(warmup_complete[cpu]) {
+            cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << " reset fetched: " << +LQ.entry[lq_index].fetched;
+            cout << " to obey WAR store instr_id: " << SQ.entry[sq_index].instr_id << " cycle: " << current_core_cycle[cpu] << endl; });
         }
     }
 
@@ -969,13 +1254,15 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
 
             uint32_t fwr_rob_index = LQ.entry[lq_index].rob_index;
             ROB.entry[fwr_rob_index].num_mem_ops--;
-            ROB.entry[fwr_rob_index].event_cycle = current_core_cycle[cpu];
+            ROB.event_cycle[fwr_rob_index] = current_core_cycle[cpu];
             if (ROB.entry[fwr_rob_index].num_mem_ops < 0) {
                 cerr << "instr_id: " << ROB.entry[fwr_rob_index].instr_id << endl;
                 assert(0);
             }
-            if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+            if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                add_completion(fwr_rob_index);
+            }
 
             DP(if(warmup_complete[cpu]) {
             cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1091,6 +1378,46 @@ void O3_CPU::add_store_queue(uint32_t rob_index, uint32_t data_index)
     cout << " cycle: " << current_core_cycle[cpu] << endl; });
 }
 
+uint32_t O3_CPU::store_address_set(uint64_t address)
+{
+    return ((address >> 3) ^ (address >> 13) ^ (address >> 23)) & (STORE_TABLE_SET - 1);
+}
+
+void O3_CPU::add_store_address(uint32_t rob_index)
+{
+    // instructions enter the ROB in program order, so a new store goes in front of its bucket
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i] == 0)
+            continue;
+
+        uint32_t node = rob_index*NUM_INSTR_DESTINATIONS_SPARC + i,
+                 set = store_address_set(ROB.entry[rob_index].destination_memory[i]);
+
+        store_table_prev[node] = UINT32_MAX;
+        store_table_next[node] = store_table[set];
+        if (store_table[set] != UINT32_MAX)
+            store_table_prev[store_table[set]] = node;
+        store_table[set] = node;
+    }
+}
+
+void O3_CPU::release_store_address(uint32_t rob_index)
+{
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i] == 0)
+            continue;
+
+        uint32_t node = rob_index*NUM_INSTR_DESTINATIONS_SPARC + i;
+
+        if (store_table_prev[node] == UINT32_MAX)
+            store_table[store_address_set(ROB.entry[rob_index].destination_memory[i])] = store_table_next[node];
+        else
+            store_table_next[store_table_prev[node]] = store_table_next[node];
+        if (store_table_next[node] != UINT32_MAX)
+            store_table_prev[store_table_next[node]] = store_table_prev[node];
+    }
+}
+
 void O3_CPU::operate_lsq()
 {
     // handle store
@@ -1269,13 +1596,15 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
     SQ.entry[sq_index].event_cycle = current_core_cycle[cpu];
 
     ROB.entry[rob_index].num_mem_ops--;
-    ROB.entry[rob_index].event_cycle = current_core_cycle[cpu];
+    ROB.event_cycle[rob_index] = current_core_cycle[cpu];
     if (ROB.entry[rob_index].num_mem_ops < 0) {
         cerr << "instr_id: " << ROB.entry[rob_index].instr_id << endl;
         assert(0);
     }
-    if (ROB.entry[rob_index].num_mem_ops == 0)
+    if (ROB.entry[rob_index].num_mem_ops == 0) {
         inflight_mem_executions++;
+        add_completion(rob_index);
+    }
 
     DP (if (warmup_complete[cpu]) {
     cout << "[SQ1] " << __func__ << " instr_id: " << SQ.entry[sq_index].instr_id << hex;
@@ -1310,15 +1639,17 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
 
                         uint32_t fwr_rob_index = LQ.entry[lq_index].rob_index;
                         ROB.entry[fwr_rob_index].num_mem_ops--;
-                        ROB.entry[fwr_rob_index].event_cycle = current_core_cycle[cpu];
+                        ROB.event_cycle[fwr_rob_index] = current_core_cycle[cpu];
 #ifdef SANITY_CHECK
                         if (ROB.entry[fwr_rob_index].num_mem_ops < 0) {
                             cerr << "instr_id: " << ROB.entry[fwr_rob_index].instr_id << endl;
                             assert(0);
                         }
 #endif
-                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                             inflight_mem_executions++;
+                            add_completion(fwr_rob_index);
+                        }
 
                         DP(if(warmup_complete[cpu]) {
                         cout << "[LQ3] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1368,9 +1699,9 @@ int O3_CPU::execute_load(uint32_t rob_index, uint32_t lq_index, uint32_t data_in
 void O3_CPU::complete_execution(uint32_t rob_index)
 {
     if (ROB.entry[rob_index].is_memory == 0) {
-        if ((ROB.entry[rob_index].executed == INFLIGHT) && (ROB.entry[rob_index].event_cycle <= current_core_cycle[cpu])) {
+        if ((ROB.executed[rob_index] == INFLIGHT) && (ROB.event_cycle[rob_index] <= current_core_cycle[cpu])) {
 
-            ROB.entry[rob_index].executed = COMPLETED; 
+            ROB.executed[rob_index] = COMPLETED; 
             inflight_reg_executions--;
             completed_executions++;
 
@@ -1383,13 +1714,13 @@ void O3_CPU::complete_execution(uint32_t rob_index)
             DP(if(warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id;
             cout << " branch_mispredicted: " << +ROB.entry[rob_index].branch_mispredicted << " fetch_stall: " << +fetch_stall;
-            cout << " event: " << ROB.entry[rob_index].event_cycle << endl; });
+            cout << " event: " << ROB.event_cycle[rob_index] << endl; });
         }
     }
     else {
         if (ROB.entry[rob_index].num_mem_ops == 0) {
-            if ((ROB.entry[rob_index].executed == INFLIGHT) && (ROB.entry[rob_index].event_cycle <= current_core_cycle[cpu])) {
-                ROB.entry[rob_index].executed = COMPLETED;
+            if ((ROB.executed[rob_index] == INFLIGHT) && (ROB.event_cycle[rob_index] <= current_core_cycle[cpu])) {
+                ROB.executed[rob_index] = COMPLETED;
                 inflight_mem_executions--;
                 completed_executions++;
                 
@@ -1402,7 +1733,7 @@ void O3_CPU::complete_execution(uint32_t rob_index)
                 DP(if(warmup_complete[cpu]) {
                 cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id;
                 cout << " is_memory: " << +ROB.entry[rob_index].is_memory << " branch_mispredicted: " << +ROB.entry[rob_index].branch_mispredicted;
-                cout << " fetch_stall: " << +fetch_stall << " event: " << ROB.entry[rob_index].event_cycle << " current: " << current_core_cycle[cpu] << endl; });
+                cout << " fetch_stall: " << +fetch_stall << " event: " << ROB.event_cycle[rob_index] << " current: " << current_core_cycle[cpu] << endl; });
             }
         }
     }
@@ -1418,11 +1749,11 @@ void O3_CPU::reg_RAW_release(uint32_t rob_index)
                 ROB.entry[i].num_reg_dependent--;
 
                 if (ROB.entry[i].num_reg_dependent == 0) {
-                    ROB.entry[i].reg_ready = 1;
+                    ROB.reg_ready[i] = 1;
                     if (ROB.entry[i].is_memory)
-                        ROB.entry[i].scheduled = INFLIGHT;
+                        ROB.scheduled[i] = INFLIGHT;
                     else {
-                        ROB.entry[i].scheduled = COMPLETED;
+                        ROB.scheduled[i] = COMPLETED;
 
 #ifdef SANITY_CHECK
                         if (RTE0[RTE0_tail] < ROB_SIZE)
@@ -1475,20 +1806,71 @@ void O3_CPU::update_rob()
         complete_data_fetch(&L1D.PROCESSED, 0);
 
     // update ROB entries with completed executions
-    if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
-        if (ROB.head < ROB.tail) {
-            for (uint32_t i=ROB.head; i<ROB.tail; i++) 
-                complete_execution(i);
-        }
-        else {
-            for (uint32_t i=ROB.head; i<ROB.SIZE; i++)
-                complete_execution(i);
-            for (uint32_t i=0; i<ROB.tail; i++)
-                complete_execution(i);
+    // only the entries whose events are due, in ROB order like a sweep from the head
+    completion_due.clear();
+    while (completion_queue.size() && (completion_queue[0].first <= current_core_cycle[cpu])) {
+        uint32_t rob_index = completion_queue[0].second,
+                 age = (rob_index + ROB.SIZE - ROB.head) % ROB.SIZE,
+                 i = completion_due.size();
+        remove_completion();
+
+        completion_due.push_back(rob_index);
+        while ((i > 0) && (((completion_due[i-1] + ROB.SIZE - ROB.head) % ROB.SIZE) > age)) {
+            completion_due[i] = completion_due[i-1];
+            i--;
         }
+        completion_due[i] = rob_index;
+    }
+
+    for (uint32_t i=0; i<completion_due.size(); i++) {
+        complete_execution(completion_due[i]);
+
+        // the event_cycle moved later, check again then
+        add_completion(completion_due[i]);
     }
 }
 
+void O3_CPU::add_completion(uint32_t rob_index)
+{
+    // complete_execution() needs the instruction executing and, for memory instructions, all its loads and stores done
+    if ((ROB.executed[rob_index] != INFLIGHT) || (ROB.entry[rob_index].is_memory && ROB.entry[rob_index].num_mem_ops))
+        return;
+
+    pair<uint64_t, uint32_t> event(ROB.event_cycle[rob_index], rob_index);
+    uint32_t i = completion_queue.size();
+    completion_queue.push_back(event);
+    while ((i > 0) && (event < completion_queue[(i-1)/2])) {
+        completion_queue[i] = completion_queue[(i-1)/2];
+        i = (i-1)/2;
+    }
+    completion_queue[i] = event;
+}
+
+void O3_CPU::remove_completion()
+{
+    // take the earliest event off the heap
+    pair<uint64_t, uint32_t> last = completion_queue.back();
+    completion_queue.pop_back();
+
+    uint32_t size = completion_queue.size(), i = 0;
+    if (size == 0)
+        return;
+
+    while (1) {
+        uint32_t child = 2*i + 1;
+        if (child >= size)
+            break;
+        if (((child+1) < size) && (completion_queue[child+1] < completion_queue[child]))
+            child++;
+        if (!(completion_queue[child] < last))
+            break;
+
+        completion_queue[i] = completion_queue[child];
+        i = child;
+    }
+    completion_queue[i] = last;
+}
+
 void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
 {
     uint32_t index = queue->head,
@@ -1502,38 +1884,38 @@ void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
 
     // update ROB entry
     if (is_it_tlb) {
-        ROB.entry[rob_index].translated = COMPLETED;
+        ROB.translated[rob_index] = COMPLETED;
         ROB.entry[rob_index].instruction_pa = (queue->entry[index].instruction_pa << LOG2_PAGE_SIZE) | (ROB.entry[rob_index].ip & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
     }
     else
-        ROB.entry[rob_index].fetched = COMPLETED;
-    ROB.entry[rob_index].event_cycle = current_core_cycle[cpu];
+        ROB.fetched[rob_index] = COMPLETED;
+    ROB.event_cycle[rob_index] = current_core_cycle[cpu];
     num_fetched++;
 
     DP ( if (warmup_complete[cpu]) {
     cout << "[" << queue->NAME << "] " << __func__ << " cpu: " << cpu <<  " instr_id: " << ROB.entry[rob_index].instr_id;
     cout << " ip: " << hex << ROB.entry[rob_index].ip << " address: " << ROB.entry[rob_index].instruction_pa << dec;
-    cout << " translated: " << +ROB.entry[rob_index].translated << " fetched: " << +ROB.entry[rob_index].fetched;
-    cout << " event_cycle: " << ROB.entry[rob_index].event_cycle << endl; });
+    cout << " translated: " << +ROB.translated[rob_index] << " fetched: " << +ROB.fetched[rob_index];
+    cout << " event_cycle: " << ROB.event_cycle[rob_index] << endl; });
 
     // check if other instructions were merged
     if (queue->entry[index].instr_merged) {
 	ITERATE_SET(i,queue->entry[index].rob_index_depend_on_me, ROB_SIZE) {
             // update ROB entry
             if (is_it_tlb) {
-                ROB.entry[i].translated = COMPLETED;
+                ROB.translated[i] = COMPLETED;
                 ROB.entry[i].instruction_pa = (queue->entry[index].instruction_pa << LOG2_PAGE_SIZE) | (ROB.entry[i].ip & ((1 << LOG2_PAGE_SIZE) - 1)); // translated address
             }
             else
-                ROB.entry[i].fetched = COMPLETED;
-            ROB.entry[i].event_cycle = current_core_cycle[cpu] + (num_fetched / FETCH_WIDTH);
+                ROB.fetched[i] = COMPLETED;
+            ROB.event_cycle[i] = current_core_cycle[cpu] + (num_fetched / FETCH_WIDTH);
             num_fetched++;
 
             DP ( if (warmup_complete[cpu]) {
             cout << "[" << queue->NAME << "] " << __func__ << " cpu: " << cpu <<  " instr_id: " << ROB.entry[i].instr_id;
             cout << " ip: " << hex << ROB.entry[i].ip << " address: " << ROB.entry[i].instruction_pa << dec;
-            cout << " translated: " << +ROB.entry[i].translated << " fetched: " << +ROB.entry[i].fetched << " provider: " << ROB.entry[rob_index].instr_id;
-            cout << " event_cycle: " << ROB.entry[i].event_cycle << endl; });
+            cout << " translated: " << +ROB.translated[i] << " fetched: " << +ROB.fetched[i] << " provider: " << ROB.entry[rob_index].instr_id;
+            cout << " event_cycle: " << ROB.event_cycle[i] << endl; });
         }
     }
 
@@ -1599,7 +1981,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             handle_merged_translation(&queue->entry[index]);
         }
 
-        ROB.entry[rob_index].event_cycle = queue->entry[index].event_cycle;
+        ROB.event_cycle[rob_index] = queue->entry[index].event_cycle;
     }
     else { // L1D
 
@@ -1613,7 +1995,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             LQ.entry[lq_index].fetched = COMPLETED;
             LQ.entry[lq_index].event_cycle = current_core_cycle[cpu];
             ROB.entry[rob_index].num_mem_ops--;
-            ROB.entry[rob_index].event_cycle = queue->entry[index].event_cycle;
+            ROB.event_cycle[rob_index] = queue->entry[index].event_cycle;
 
 #ifdef SANITY_CHECK
             if (ROB.entry[rob_index].num_mem_ops < 0) {
@@ -1621,8 +2003,10 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
                 assert(0);
             }
 #endif
-            if (ROB.entry[rob_index].num_mem_ops == 0)
+            if (ROB.entry[rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                add_completion(rob_index);
+            }
 
             DP (if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[lq_index].instr_id;
@@ -1691,7 +2075,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
             handle_merged_translation(current_packet);
         }
 
-        ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
+        ROB.event_cycle[rob_index] = current_packet->event_cycle;
     }
     else { // L1D
 
@@ -1727,7 +2111,8 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
 
             handle_merged_load(current_packet);
 
-            ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
+            ROB.event_cycle[rob_index] = current_packet->event_cycle;
+            add_completion(rob_index);
         }
     }
 }
@@ -1782,7 +2167,7 @@ void O3_CPU::handle_merged_load(PACKET *provider)
         LQ.entry[merged].fetched = COMPLETED;
         LQ.entry[merged].event_cycle = current_core_cycle[cpu];
         ROB.entry[merged_rob_index].num_mem_ops--;
-        ROB.entry[merged_rob_index].event_cycle = current_core_cycle[cpu];
+        ROB.event_cycle[merged_rob_index] = current_core_cycle[cpu];
 
 #ifdef SANITY_CHECK
         if (ROB.entry[merged_rob_index].num_mem_ops < 0) {
@@ -1791,8 +2176,10 @@ void O3_CPU::handle_merged_load(PACKET *provider)
         }
 #endif
 
-        if (ROB.entry[merged_rob_index].num_mem_ops == 0)
+        if (ROB.entry[merged_rob_index].num_mem_ops == 0) {
             inflight_mem_executions++;
+            add_completion(merged_rob_index);
+        }
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[merged].instr_id;
@@ -1813,6 +2200,7 @@ void O3_CPU::release_load_queue(uint32_t lq_index)
 
     LSQ_ENTRY empty_entry;
     LQ.entry[lq_index] = empty_entry;
+    LQ_free[lq_index/64] |= (1ull << (lq_index % 64));
     LQ.occupancy--;
 }
 
@@ -1823,7 +2211,7 @@ void O3_CPU::retire_rob()
             return;
 
         // retire is in-order
-        if (ROB.entry[ROB.head].executed != COMPLETED) { 
+        if (ROB.executed[ROB.head] != COMPLETED) { 
             DP ( if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[ROB.head].instr_id << " head: " << ROB.head << " is not executed yet" << endl; });
             return;
@@ -1899,8 +2287,17 @@ void O3_CPU::retire_rob()
         DP ( if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[ROB.head].instr_id << " is retired" << endl; });
 
-        ooo_model_instr empty_entry;
-        ROB.entry[ROB.head] = empty_entry;
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (ROB.entry[ROB.head].destination_registers[i] && (RAT[ROB.entry[ROB.head].destination_registers[i]] == ROB.head))
+                RAT[ROB.entry[ROB.head].destination_registers[i]] = ROB_SIZE;
+        }
+        if (ROB.entry[ROB.head].is_memory)
+            release_store_address(ROB.head);
+
+        // the next add_to_rob overwrites the whole entry, so only mark the slot empty and reset its pipeline state
+        ROB.entry[ROB.head].instr_id = 0;
+        ROB.entry[ROB.head].ip = 0;
+        ROB.clear_state(ROB.head);
 
         ROB.head++;
         if (ROB.head == ROB.SIZE)
@@ -1910,3 +2307,152 @@ void O3_CPU::retire_rob()
         num_retired++;
     }
 }
+
+uint64_t O3_CPU::get_next_event_cycle()
+{
+    // earliest cycle at which this core or its private caches can make progress
+    // a value that is not in the future means that there is work to do right now
+    uint64_t next_event = UINT64_MAX;
+
+    // deadlock check
+    if (ROB.entry[ROB.head].ip)
+        next_event = ROB.event_cycle[ROB.head] + DEADLOCK_CYCLE;
+
+    // nothing in the pipeline moves while the core is stalled
+    uint64_t earliest = (stall_cycle[cpu] > current_core_cycle[cpu]) ? stall_cycle[cpu] : current_core_cycle[cpu];
+    if (earliest > next_event)
+        earliest = next_event;
+
+    // -memory_only dispatches every cycle it has room and retires as soon as the oldest loads are back,
+    // otherwise it waits on the caches like the pipeline below
+    if (knob_memory_only) {
+        if ((memory_window_occupancy < ROB_SIZE) || (memory_window[memory_window_head].pending_loads == 0))
+            return earliest;
+    }
+    // handle branch reads the trace every cycle
+    else if ((ROB.occupancy < ROB.SIZE) && (fetch_stall == 0) && (fetch_drain == 0))
+        return earliest;
+
+    // fetch
+    uint32_t read_index = (ROB.last_read == (ROB.SIZE-1)) ? 0 : (ROB.last_read + 1);
+    if (ROB.entry[read_index].ip && (ROB.translated[read_index] == 0))
+        return earliest;
+
+    uint32_t fetch_index = (ROB.last_fetch == (ROB.SIZE-1)) ? 0 : (ROB.last_fetch + 1);
+    if ((ROB.translated[fetch_index] == COMPLETED) && ((ROB.fetched[fetch_index] == 0) || (fetch_index != ROB.head))) {
+        if (ROB.event_cycle[fetch_index] < next_event)
+            next_event = ROB.event_cycle[fetch_index];
+    }
+
+    // schedule
+    // schedule_instruction() scans in order from the head, so the next entry to be scheduled is only reached
+    // once every entry in front of it is ready and it is within the scheduler window
+    uint32_t schedule_index = ROB.next_schedule;
+    if ((ROB.scheduled[schedule_index] == 0) && (ROB.fetched[schedule_index] == COMPLETED)) {
+        uint32_t limit = ROB.next_fetch[1], num_scanned = 0, i = ROB.head;
+        uint64_t schedule_event = 0;
+        while (1) {
+            if ((ROB.head < limit) ? (i >= limit) : ((i < ROB.head) && (i >= limit))) {
+                schedule_event = UINT64_MAX;
+                break;
+            }
+            if ((ROB.fetched[i] != COMPLETED) || (num_scanned >= SCHEDULER_SIZE)) {
+                schedule_event = UINT64_MAX;
+                break;
+            }
+            if (ROB.event_cycle[i] > schedule_event)
+                schedule_event = ROB.event_cycle[i];
+            if (i == schedule_index)
+                break;
+
+            num_scanned++;
+            i++;
+            if (i == ROB.SIZE)
+                i = 0;
+        }
+
+        if (schedule_event < next_event)
+            next_event = schedule_event;
+    }
+
+    // execute
+    if ((RTE0[RTE0_head] < ROB_SIZE) && (ROB.event_cycle[RTE0[RTE0_head]] < next_event))
+        next_event = ROB.event_cycle[RTE0[RTE0_head]];
+    if ((RTE1[RTE1_head] < ROB_SIZE) && (ROB.event_cycle[RTE1[RTE1_head]] < next_event))
+        next_event = ROB.event_cycle[RTE1[RTE1_head]];
+
+    // load/store queue
+    if ((RTS0[RTS0_head] < SQ_SIZE) && (SQ.entry[RTS0[RTS0_head]].event_cycle < next_event))
+        next_event = SQ.entry[RTS0[RTS0_head]].event_cycle;
+    if ((RTS1[RTS1_head] < SQ_SIZE) && (SQ.entry[RTS1[RTS1_head]].event_cycle < next_event))
+        next_event = SQ.entry[RTS1[RTS1_head]].event_cycle;
+    if ((RTL0[RTL0_head] < LQ_SIZE) && (LQ.entry[RTL0[RTL0_head]].event_cycle < next_event))
+        next_event = LQ.entry[RTL0[RTL0_head]].event_cycle;
+    if ((RTL1[RTL1_head] < LQ_SIZE) && (LQ.entry[RTL1[RTL1_head]].event_cycle < next_event))
+        next_event = LQ.entry[RTL1[RTL1_head]].event_cycle;
+
+    // private caches
+    CACHE *cache[6] = {&ITLB, &DTLB, &STLB, &L1I, &L1D, &L2C};
+    for (uint32_t i=0; i<6; i++) {
+        uint64_t cache_event = cache[i]->get_next_event_cycle();
+        if (cache_event < next_event)
+            next_event = cache_event;
+    }
+
+    // complete
+    PACKET_QUEUE *processed[4] = {&ITLB.PROCESSED, &L1I.PROCESSED, &DTLB.PROCESSED, &L1D.PROCESSED};
+    for (uint32_t i=0; i<4; i++) {
+        if (processed[i]->occupancy && (processed[i]->entry[processed[i]->head].event_cycle < next_event))
+            next_event = processed[i]->entry[processed[i]->head].event_cycle;
+    }
+
+    // retire
+    if ((ROB.executed[ROB.head] == COMPLETED) && (ROB.event_cycle[ROB.head] < next_event))
+        next_event = ROB.event_cycle[ROB.head];
+
+    if (next_event <= earliest)
+        return earliest;
+
+    // walk the ROB for completions and for memory instructions that can still be added to the LQ/SQ
+    uint32_t rob_index = ROB.head;
+    for (uint32_t n=0; n<ROB.occupancy; n++) {
+        if ((ROB.executed[rob_index] == INFLIGHT) && ((ROB.entry[rob_index].is_memory == 0) || (ROB.entry[rob_index].num_mem_ops == 0))) {
+            if (ROB.event_cycle[rob_index] < next_event)
+                next_event = ROB.event_cycle[rob_index];
+        }
+
+        if (ROB.entry[rob_index].is_memory && ROB.reg_ready[rob_index] && (ROB.scheduled[rob_index] == INFLIGHT) && (ROB.fetched[rob_index] == COMPLETED)) {
+            uint32_t num_mem_ops = 0, num_added = 0, can_add = 0;
+            for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+                if (ROB.entry[rob_index].source_memory[i]) {
+                    num_mem_ops++;
+                    if (ROB.entry[rob_index].source_added[i])
+                        num_added++;
+                    else if (LQ.occupancy < LQ.SIZE)
+                        can_add = 1;
+                }
+            }
+            for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+                if (ROB.entry[rob_index].destination_memory[i]) {
+                    num_mem_ops++;
+                    if (ROB.entry[rob_index].destination_added[i])
+                        num_added++;
+                    else if ((SQ.occupancy < SQ.SIZE) && (STA[STA_head] == ROB.entry[rob_index].instr_id))
+                        can_add = 1;
+                }
+            }
+
+            if ((can_add || (num_added == num_mem_ops)) && (ROB.event_cycle[rob_index] < next_event))
+                next_event = ROB.event_cycle[rob_index];
+        }
+
+        rob_index++;
+        if (rob_index == ROB.SIZE)
+            rob_index = 0;
+    }
+
+    if (next_event < earliest)
+        return earliest;
+
+    return next_event;
+}
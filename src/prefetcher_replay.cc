@@ -0,0 +1,295 @@
+#include "prefetcher_replay.h"
+#include "access_stream.h"
+#include <unordered_map>
+#include <chrono>
+
+int REPLAY_CACHE::lookup(uint64_t line)
+{
+    REPLAY_BLOCK *set = &block[(line & (num_set - 1)) * num_way];
+    for (uint32_t way=0; way<num_way; way++) {
+        if (set[way].valid && (set[way].line == line)) {
+            set[way].lru = ++lru_clock;
+            return way;
+        }
+    }
+    return -1;
+}
+
+REPLAY_BLOCK REPLAY_CACHE::fill(uint64_t line, uint8_t prefetch, uint64_t pf_instr, uint32_t &way)
+{
+    REPLAY_BLOCK *set = &block[(line & (num_set - 1)) * num_way];
+    way = 0;
+    for (uint32_t w=0; w<num_way; w++) {
+        if (set[w].valid == 0) {
+            way = w;
+            break;
+        }
+        if (set[w].lru < set[way].lru)
+            way = w;
+    }
+
+    REPLAY_BLOCK victim = set[way];
+    set[way].line = line;
+    set[way].lru = ++lru_clock;
+    set[way].pf_instr = pf_instr;
+    set[way].valid = 1;
+    set[way].prefetch = prefetch;
+    return victim;
+}
+
+class REPLAY_STATS {
+  public:
+    uint64_t accesses, loads, misses,
+             issued, redundant, lower_level, // prefetches that filled, that were cached already, that fill a lower level
+             useful, useless, late,
+             distance[REPLAY_DISTANCE_BUCKETS]; // prefetch to first use, log2 buckets of instructions
+
+    REPLAY_STATS() {
+        memset(this, 0, sizeof(REPLAY_STATS));
+    }
+};
+
+class PREFETCHER_REPLAY {
+  public:
+    CACHE *cache;
+    uint8_t is_l1d, filter;
+    int fill_level;
+    REPLAY_CACHE upper, model; // upper filters the L2C stream when it comes from the trace
+    REPLAY_STATS stats;
+    uint64_t instr, begin_requested, begin_refused;
+
+    PREFETCHER_REPLAY(CACHE *c, uint8_t l1d, uint8_t from_trace) : cache(c), is_l1d(l1d), filter(from_trace && (l1d == 0)),
+        fill_level(l1d ? FILL_L1 : FILL_L2), upper(L1D_SET, L1D_WAY), model(c->NUM_SET, c->NUM_WAY), instr(0), begin_requested(0), begin_refused(0) {}
+
+    // the warmup is over
+    void begin_measure() {
+        stats = REPLAY_STATS();
+        begin_requested = cache->pf_requested;
+        begin_refused = cache->pf_requested - cache->pf_issued;
+        warmup_complete[0] = 1;
+    }
+
+    // the address the prefetcher sees for a line: the whole address in the L1D, the block address below it
+    uint64_t prefetcher_addr(uint64_t full_addr) {
+        return is_l1d ? full_addr : ((full_addr >> LOG2_BLOCK_SIZE) << LOG2_BLOCK_SIZE);
+    }
+
+    void fill(uint64_t full_addr, uint8_t prefetch, uint32_t metadata) {
+        uint32_t way;
+        uint64_t line = full_addr >> LOG2_BLOCK_SIZE;
+        REPLAY_BLOCK victim = model.fill(line, prefetch, instr, way);
+        if (victim.valid && victim.prefetch)
+            stats.useless++;
+
+        uint64_t evicted_addr = victim.valid ? (victim.line << LOG2_BLOCK_SIZE) : 0;
+        uint32_t set = line & (model.num_set - 1);
+        if (is_l1d)
+            cache->l1d_prefetcher_cache_fill(prefetcher_addr(full_addr), set, way, prefetch, evicted_addr, metadata);
+        else
+            cache->l2c_prefetcher_cache_fill(prefetcher_addr(full_addr), set, way, prefetch, evicted_addr, metadata);
+    }
+
+    // prefetch_line() left the prefetches in the PQ, they fill right away
+    void issue_prefetches() {
+        while (cache->PQ.occupancy) {
+            PACKET *packet = &cache->PQ.entry[cache->PQ.head];
+
+            if (packet->fill_level > fill_level)
+                stats.lower_level++;
+            else if (model.lookup(packet->address) >= 0)
+                stats.redundant++;
+            else {
+                stats.issued++;
+                fill(packet->full_addr, 1, packet->pf_metadata);
+            }
+
+            cache->PQ.remove_queue(packet);
+        }
+    }
+
+    void access(uint64_t full_addr, uint64_t ip, uint8_t type) {
+        uint64_t line = full_addr >> LOG2_BLOCK_SIZE;
+
+        if (filter) {
+            if (upper.lookup(line) >= 0)
+                return;
+            uint32_t way;
+            upper.fill(line, 0, 0, way);
+        }
+
+        stats.accesses++;
+        if (type == LOAD)
+            stats.loads++;
+
+        int way = model.lookup(line);
+        if (way >= 0) {
+            REPLAY_BLOCK &hit = model.block[(line & (model.num_set - 1)) * model.num_way + way];
+            if (hit.prefetch) {
+                uint64_t distance = instr - hit.pf_instr;
+                uint32_t bucket = 0;
+                while ((distance >> bucket) && (bucket < (REPLAY_DISTANCE_BUCKETS - 1)))
+                    bucket++;
+
+                stats.useful++;
+                stats.distance[bucket]++;
+                if (distance < REPLAY_LATE_INSTRUCTIONS)
+                    stats.late++;
+                hit.prefetch = 0;
+            }
+        }
+        else
+            stats.misses++;
+
+        // as in the caches, loads train the prefetcher, and so do the prefetches of upper levels a recorded stream holds
+        if ((type == LOAD) || (type == PREFETCH)) {
+            if (is_l1d)
+                cache->l1d_prefetcher_operate(prefetcher_addr(full_addr), ip, (way >= 0), type);
+            else
+                cache->l2c_prefetcher_operate(prefetcher_addr(full_addr), ip, (way >= 0), type, 0);
+            issue_prefetches();
+        }
+
+        if (way < 0)
+            fill(full_addr, 0, 0);
+    }
+};
+
+static double percent(uint64_t part, uint64_t whole)
+{
+    return whole ? ((100.0 * part) / whole) : 0;
+}
+
+// cpu 0's accesses in a stream recorded by -record_stream at the replayed level, instructions count from its first record
+static void replay_stream(PREFETCHER_REPLAY &replay, string stream_file, uint64_t num_warm, uint64_t num_measure,
+                          chrono::steady_clock::time_point &begin)
+{
+    ACCESS_STREAM_READER stream(stream_file);
+    if (stream.level != replay.cache->NAME) {
+        cerr << stream_file << " was recorded at the " << stream.level << ", not the " << replay.cache->NAME << endl;
+        assert(0);
+    }
+
+    ACCESS_RECORD record;
+    uint64_t first_instr = UINT64_MAX;
+    while (stream.next(record)) {
+        if (record.cpu != 0)
+            continue;
+        if (first_instr == UINT64_MAX)
+            first_instr = record.instr;
+
+        replay.instr = record.instr - first_instr;
+        if (replay.instr >= (num_warm + num_measure))
+            return;
+        if ((warmup_complete[0] == 0) && (replay.instr >= num_warm)) {
+            replay.begin_measure();
+            begin = chrono::steady_clock::now();
+        }
+        current_core_cycle[0] = record.cycle;
+
+        // the prefetches of the replayed level itself are what the replay stands in for
+        if ((record.type == PREFETCH) && ((int)record.pf_origin_level == replay.fill_level))
+            continue;
+
+        replay.access(record.full_addr, record.ip, record.type);
+    }
+
+    cout << "*** " << stream_file << " ends at instruction " << replay.instr << " of " << (num_warm + num_measure) << endl;
+}
+
+void replay_prefetcher(string level, string stream_file, uint64_t num_warm, uint64_t num_measure)
+{
+    O3_CPU *core = &ooo_cpu[0];
+    PREFETCHER_REPLAY replay((level == "l1d") ? &core->L1D : &core->L2C, (level == "l1d"), stream_file.empty());
+    unordered_map <uint64_t, uint64_t> page; // virtual to physical page, va_to_pa() is only asked once per page
+
+    size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
+    uint64_t chunk_size = 4096;
+    vector <uint8_t> buffer(chunk_size * instr_size);
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+    if (stream_file.size())
+        replay_stream(replay, stream_file, num_warm, num_measure, begin);
+
+    while (stream_file.empty() && (replay.instr < (num_warm + num_measure))) {
+        uint64_t num_to_read = ((num_warm + num_measure - replay.instr) < chunk_size) ? (num_warm + num_measure - replay.instr) : chunk_size;
+        uint64_t num_read = core->read_trace(buffer.data(), num_to_read);
+
+        for (uint64_t n=0; n<num_read; n++, replay.instr++) {
+            if (replay.instr == num_warm) {
+                replay.begin_measure();
+                begin = chrono::steady_clock::now();
+            }
+            current_core_cycle[0] = replay.instr;
+
+            uint64_t ip, memory[NUM_INSTR_SOURCES + NUM_INSTR_DESTINATIONS_SPARC];
+            uint8_t asid = 0;
+            if (knob_cloudsuite) {
+                cloudsuite_instr *instr = (cloudsuite_instr *)&buffer[n*instr_size];
+                ip = instr->ip;
+                asid = instr->asid[1];
+                for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+                    memory[i] = instr->source_memory[i];
+                for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+                    memory[NUM_INSTR_SOURCES + i] = instr->destination_memory[i];
+            }
+            else {
+                input_instr *instr = (input_instr *)&buffer[n*instr_size];
+                ip = instr->ip;
+                for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+                    memory[i] = instr->source_memory[i];
+                for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+                    memory[NUM_INSTR_SOURCES + i] = (i < NUM_INSTR_DESTINATIONS) ? instr->destination_memory[i] : 0;
+            }
+
+            // loads first, then stores, as they leave the LSQ
+            for (uint32_t i=0; i<(NUM_INSTR_SOURCES + NUM_INSTR_DESTINATIONS_SPARC); i++) {
+                uint64_t virtual_address = memory[i];
+                if (virtual_address == 0)
+                    continue;
+
+                uint64_t vpage = knob_cloudsuite ? (((virtual_address >> LOG2_PAGE_SIZE) << 9) | asid) : (virtual_address >> LOG2_PAGE_SIZE);
+                unordered_map<uint64_t, uint64_t>::iterator it = page.find(vpage);
+                if (it == page.end())
+                    it = page.insert(make_pair(vpage, va_to_pa(0, replay.instr, virtual_address, vpage) >> LOG2_PAGE_SIZE)).first;
+
+                replay.access((it->second << LOG2_PAGE_SIZE) | (virtual_address & ((1 << LOG2_PAGE_SIZE) - 1)), ip, (i < NUM_INSTR_SOURCES) ? LOAD : RFO);
+            }
+        }
+
+        if (num_read < num_to_read) {
+            // reached end of file for this trace
+            cout << "*** Reached end of trace for Core: 0 Repeating trace: " << core->trace_string << endl;
+
+            // start the trace over
+
+            core->trace_file->restart();
+        }
+    }
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    REPLAY_STATS &stats = replay.stats;
+    uint64_t requested = replay.cache->pf_requested - replay.begin_requested,
+             refused = replay.cache->pf_requested - replay.cache->pf_issued - replay.begin_refused;
+
+    cout << endl << "Prefetcher replay " << replay.cache->NAME << ": " << num_measure << " instructions after " << num_warm << " warmup ("
+         << elapsed << " s, " << ((elapsed > 0) ? (stats.accesses / elapsed) : 0) << " accesses/s)" << endl;
+    cout << "ACCESS: " << stats.accesses << " LOAD: " << stats.loads << " HIT: " << (stats.accesses - stats.misses) << " MISS: " << stats.misses << endl;
+    cout << "PREFETCH REQUESTED: " << requested << " REFUSED: " << refused << " ISSUED: " << stats.issued
+         << " ALREADY CACHED: " << stats.redundant << " LOWER LEVEL: " << stats.lower_level << endl;
+    cout << "PREFETCH USEFUL: " << stats.useful << " USELESS: " << stats.useless
+         << " LATE (used within " << REPLAY_LATE_INSTRUCTIONS << " instructions): " << stats.late << endl;
+    cout << fixed << setprecision(2);
+    cout << "Accuracy: " << percent(stats.useful, stats.issued) << "% Coverage: " << percent(stats.useful, stats.useful + stats.misses)
+         << "% Late: " << percent(stats.late, stats.useful) << "%" << endl;
+    cout.unsetf(ios::fixed);
+
+    cout << "Prefetch to first use (instructions)      prefetches" << endl;
+    for (uint32_t b=0; b<REPLAY_DISTANCE_BUCKETS; b++) {
+        if (stats.distance[b] == 0)
+            continue;
+        uint64_t low = b ? (1ull << (b-1)) : 0, high = b ? ((1ull << b) - 1) : 0;
+        cout << "  " << setw(10) << low << " - " << setw(10) << high << " " << setw(12) << stats.distance[b] << endl;
+    }
+
+    replay.cache->prefetcher_final_stats();
+}
@@ -0,0 +1,1037 @@
+#include "trace_reader.h"
+#include <lzma.h>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <set>
+
+uint8_t knob_trace_server = 0;
+
+// traces are opened again on every restart, say where each one comes from only once
+static void announce(string message)
+{
+    static set <string> announced;
+    static mutex announced_lock;
+
+    unique_lock<mutex> guard(announced_lock);
+    if (announced.insert(message).second)
+        cout << message << endl;
+}
+
+TRACE_READER *open_trace(string filename)
+{
+    if (knob_trace_server) {
+        TRACE_READER *served = SERVED_TRACE_READER::attach(filename);
+        announce(served ? ("Reading " + filename + " from the trace server") : ("No trace server has " + filename + ", decoding it here"));
+        if (served)
+            return served;
+    }
+
+    if ((filename.size() > 4) && (filename.compare(filename.size()-4, 4, ".blk") == 0))
+        return new BLOCK_TRACE_READER(filename);
+    return new STREAM_TRACE_READER(filename);
+}
+
+// passes that still start at the first chunk, for readers that open or restart the same file to join
+static map <string, weak_ptr<SHARED_TRACE> > shared_traces;
+static mutex shared_traces_lock;
+
+TRACE_READER *open_shared_trace(string filename)
+{
+    if ((filename.size() > 4) && (filename.compare(filename.size()-4, 4, ".blk") == 0))
+        return open_trace(filename); // already shared through the page cache
+    return new SHARED_TRACE_READER(filename);
+}
+
+STREAM_TRACE_READER::STREAM_TRACE_READER(string name) : ring(TRACE_CHUNKS)
+{
+    filename = name;
+    record_size = 0;
+    start();
+}
+
+STREAM_TRACE_READER::~STREAM_TRACE_READER()
+{
+    finish();
+}
+
+void STREAM_TRACE_READER::start()
+{
+    head = 0;
+    tail = 0;
+    occupancy = 0;
+    done = 0;
+    stop = 0;
+    current.clear();
+    current_pos = 0;
+
+    decoder = thread(&STREAM_TRACE_READER::decode, this);
+}
+
+// stop the decoder wherever it is and wait for it
+void STREAM_TRACE_READER::finish()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        stop = 1;
+    }
+    not_full.notify_all();
+
+    if (decoder.joinable())
+        decoder.join();
+}
+
+void STREAM_TRACE_READER::restart()
+{
+    finish();
+    start();
+}
+
+int STREAM_TRACE_READER::push(vector <uint8_t> &chunk)
+{
+    unique_lock<mutex> guard(lock);
+    while ((occupancy == TRACE_CHUNKS) && (stop == 0))
+        not_full.wait(guard);
+    if (stop)
+        return 0;
+
+    // the ring keeps the decoded chunk, the decoder gets the ring's old buffer to fill next
+    ring[tail].swap(chunk);
+    tail = (tail + 1) % TRACE_CHUNKS;
+    occupancy++;
+    guard.unlock();
+    not_empty.notify_one();
+
+    chunk.resize(TRACE_CHUNK_SIZE);
+    return 1;
+}
+
+int STREAM_TRACE_READER::next_chunk()
+{
+    unique_lock<mutex> guard(lock);
+    while ((occupancy == 0) && (done == 0))
+        not_empty.wait(guard);
+    if (occupancy == 0)
+        return 0;
+
+    current.swap(ring[head]);
+    current_pos = 0;
+    head = (head + 1) % TRACE_CHUNKS;
+    occupancy--;
+    guard.unlock();
+    not_full.notify_one();
+
+    return 1;
+}
+
+size_t STREAM_TRACE_READER::read(void *data, size_t size, size_t count)
+{
+    uint8_t *out = (uint8_t *)data;
+    size_t num_bytes = size * count, copied = 0;
+
+    while (copied < num_bytes) {
+        if ((current_pos == current.size()) && (next_chunk() == 0))
+            break;
+
+        size_t n = current.size() - current_pos;
+        if (n > (num_bytes - copied))
+            n = num_bytes - copied;
+        memcpy(out + copied, &current[current_pos], n);
+        current_pos += n;
+        copied += n;
+    }
+
+    return copied / size;
+}
+
+uint64_t STREAM_TRACE_READER::skip(uint64_t num_bytes)
+{
+    uint64_t skipped = 0;
+
+    while (skipped < num_bytes) {
+        if ((current_pos == current.size()) && (next_chunk() == 0))
+            break;
+
+        uint64_t n = current.size() - current_pos;
+        if (n > (num_bytes - skipped))
+            n = num_bytes - skipped;
+        current_pos += n;
+        skipped += n;
+    }
+
+    return skipped;
+}
+
+void STREAM_TRACE_READER::decode()
+{
+    if ((filename.size() > 3) && (filename.compare(filename.size()-3, 3, ".xz") == 0))
+        decode_xz();
+    else
+        decode_gz(); // zlib reads uncompressed files as they are
+
+    {
+        unique_lock<mutex> guard(lock);
+        done = 1;
+    }
+    not_empty.notify_all();
+}
+
+void STREAM_TRACE_READER::decode_xz()
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        cerr << "[TRACE] cannot open " << filename << endl;
+        assert(0);
+    }
+
+    lzma_stream stream = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        cerr << "[TRACE] cannot start the xz decoder for " << filename << endl;
+        assert(0);
+    }
+
+    vector <uint8_t> input(TRACE_CHUNK_SIZE), chunk(TRACE_CHUNK_SIZE);
+    lzma_action action = LZMA_RUN;
+    stream.next_out = chunk.data();
+    stream.avail_out = chunk.size();
+
+    while (1) {
+        if ((stream.avail_in == 0) && (action == LZMA_RUN)) {
+            stream.next_in = input.data();
+            stream.avail_in = fread(input.data(), 1, input.size(), file);
+            if (ferror(file)) {
+                cerr << "[TRACE] cannot read " << filename << endl;
+                assert(0);
+            }
+            if (feof(file))
+                action = LZMA_FINISH;
+        }
+
+        lzma_ret ret = lzma_code(&stream, action);
+
+        if ((stream.avail_out == 0) || (ret == LZMA_STREAM_END)) {
+            chunk.resize(chunk.size() - stream.avail_out);
+            if (chunk.size() && (push(chunk) == 0))
+                break;
+            chunk.resize(TRACE_CHUNK_SIZE);
+            stream.next_out = chunk.data();
+            stream.avail_out = chunk.size();
+        }
+
+        if (ret == LZMA_STREAM_END)
+            break;
+        if (ret != LZMA_OK) {
+            cerr << "[TRACE] xz decoding failed for " << filename << " (error " << ret << ")" << endl;
+            assert(0);
+        }
+    }
+
+    lzma_end(&stream);
+    fclose(file);
+}
+
+void STREAM_TRACE_READER::decode_gz()
+{
+    gzFile file = gzopen(filename.c_str(), "rb");
+    if (file == NULL) {
+        cerr << "[TRACE] cannot open " << filename << endl;
+        assert(0);
+    }
+    gzbuffer(file, TRACE_CHUNK_SIZE);
+
+    vector <uint8_t> chunk(TRACE_CHUNK_SIZE);
+    while (1) {
+        int num_read = gzread(file, chunk.data(), chunk.size());
+        if (num_read < 0) {
+            int error;
+            cerr << "[TRACE] gzip decoding failed for " << filename << ": " << gzerror(file, &error) << endl;
+            assert(0);
+        }
+        if (num_read == 0)
+            break;
+
+        chunk.resize(num_read);
+        if (push(chunk) == 0)
+            break;
+    }
+
+    gzclose(file);
+}
+
+SHARED_TRACE::SHARED_TRACE(string name, uint64_t first_chunk) : filename(name)
+{
+    source = open_trace(filename);
+    done = 0;
+    base = first_chunk;
+    if (source->skip(first_chunk * TRACE_CHUNK_SIZE) < (first_chunk * TRACE_CHUNK_SIZE))
+        done = 1;
+}
+
+SHARED_TRACE::~SHARED_TRACE()
+{
+    delete source;
+}
+
+int SHARED_TRACE::get(uint64_t n, shared_ptr<vector<uint8_t> > &chunk)
+{
+    unique_lock<mutex> guard(lock);
+
+    if (n < base)
+        return -1;
+
+    while (((base + chunks.size()) <= n) && (done == 0)) {
+        shared_ptr<vector<uint8_t> > next = make_shared<vector<uint8_t> >(TRACE_CHUNK_SIZE);
+        next->resize(source->read(next->data(), 1, TRACE_CHUNK_SIZE));
+        if (next->size() < TRACE_CHUNK_SIZE)
+            done = 1;
+        if (next->size())
+            chunks.push_back(next);
+        trim();
+    }
+
+    if ((n < base) || ((base + chunks.size()) <= n))
+        return (n < base) ? -1 : 0;
+
+    chunk = chunks[n - base];
+    return 1;
+}
+
+// drop the chunks every reader is past, and the oldest ones beyond TRACE_SHARED_CHUNKS
+void SHARED_TRACE::trim()
+{
+    uint64_t needed = base + chunks.size();
+    for (uint32_t i=0; i<readers.size(); i++)
+        if (readers[i]->next_chunk < needed)
+            needed = readers[i]->next_chunk;
+
+    while (chunks.size() && ((base < needed) || (chunks.size() > TRACE_SHARED_CHUNKS))) {
+        chunks.pop_front();
+        base++;
+    }
+}
+
+void SHARED_TRACE::attach(SHARED_TRACE_READER *reader)
+{
+    unique_lock<mutex> guard(lock);
+    readers.push_back(reader);
+}
+
+void SHARED_TRACE::detach(SHARED_TRACE_READER *reader)
+{
+    unique_lock<mutex> guard(lock);
+    for (uint32_t i=0; i<readers.size(); i++) {
+        if (readers[i] == reader) {
+            readers.erase(readers.begin() + i);
+            break;
+        }
+    }
+    trim();
+}
+
+SHARED_TRACE_READER::SHARED_TRACE_READER(string name)
+{
+    filename = name;
+    record_size = 0;
+    join();
+}
+
+SHARED_TRACE_READER::~SHARED_TRACE_READER()
+{
+    trace->detach(this);
+}
+
+// start at the first chunk, with the readers of a pass that has not dropped it yet if there is one
+void SHARED_TRACE_READER::join()
+{
+    unique_lock<mutex> guard(shared_traces_lock);
+
+    next_chunk = 0;
+    current.reset();
+    current_pos = 0;
+
+    trace = shared_traces[filename].lock();
+    if (trace) {
+        unique_lock<mutex> trace_guard(trace->lock);
+        if (trace->base == 0) {
+            trace->readers.push_back(this);
+            return;
+        }
+    }
+
+    trace = make_shared<SHARED_TRACE>(filename, 0);
+    trace->attach(this);
+    shared_traces[filename] = trace;
+}
+
+void SHARED_TRACE_READER::restart()
+{
+    trace->detach(this);
+    join();
+}
+
+// moves to the next chunk, returns 0 at the end of the trace
+int SHARED_TRACE_READER::advance()
+{
+    int found = trace->get(next_chunk, current);
+
+    // this reader fell too far behind the others, it goes on alone from where it is
+    if (found < 0) {
+        trace->detach(this);
+        trace = make_shared<SHARED_TRACE>(filename, next_chunk);
+        trace->attach(this);
+        found = trace->get(next_chunk, current);
+    }
+
+    current_pos = 0;
+    if (found <= 0) {
+        current.reset();
+        return 0;
+    }
+
+    next_chunk++;
+    return 1;
+}
+
+size_t SHARED_TRACE_READER::read(void *data, size_t size, size_t count)
+{
+    uint8_t *out = (uint8_t *)data;
+    size_t num_bytes = size * count, copied = 0;
+
+    while (copied < num_bytes) {
+        if (((current == NULL) || (current_pos == current->size())) && (advance() == 0))
+            break;
+
+        size_t n = current->size() - current_pos;
+        if (n > (num_bytes - copied))
+            n = num_bytes - copied;
+        memcpy(out + copied, current->data() + current_pos, n);
+        current_pos += n;
+        copied += n;
+    }
+
+    return copied / size;
+}
+
+uint64_t SHARED_TRACE_READER::skip(uint64_t num_bytes)
+{
+    uint64_t skipped = 0;
+
+    while (skipped < num_bytes) {
+        if (((current == NULL) || (current_pos == current->size())) && (advance() == 0))
+            break;
+
+        uint64_t n = current->size() - current_pos;
+        if (n > (num_bytes - skipped))
+            n = num_bytes - skipped;
+        current_pos += n;
+        skipped += n;
+    }
+
+    return skipped;
+}
+
+string trace_server_name(string filename)
+{
+    size_t slash = filename.rfind('/');
+    return "/champsim." + ((slash == string::npos) ? filename : filename.substr(slash + 1));
+}
+
+static uint64_t trace_server_header_size()
+{
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    return ((sizeof(TRACE_SERVER_HEADER) + page_size - 1) / page_size) * page_size;
+}
+
+static int process_alive(pid_t pid)
+{
+    return (kill(pid, 0) == 0) || (errno != ESRCH);
+}
+
+// the lock survives a process that dies holding it, nothing it protects is left half updated
+static void lock_server(TRACE_SERVER_HEADER *header)
+{
+    if (pthread_mutex_lock(&header->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&header->lock);
+}
+
+// waits at most a second, so that both sides notice when the other one is gone
+static void wait_server(pthread_cond_t *cond, TRACE_SERVER_HEADER *header)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec++;
+    if (pthread_cond_timedwait(cond, &header->lock, &deadline) == EOWNERDEAD)
+        pthread_mutex_consistent(&header->lock);
+}
+
+TRACE_SERVER::TRACE_SERVER(string name) : filename(name)
+{
+    shm_name = trace_server_name(filename);
+    source = open_trace(filename);
+
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        cerr << "[TRACE] cannot create " << shm_name << ", is another server running? (a stale one is in /dev/shm)" << endl;
+        assert(0);
+    }
+
+    map_size = trace_server_header_size() + (uint64_t)TRACE_SERVER_SLOTS * TRACE_CHUNK_SIZE;
+    if (ftruncate(fd, map_size)) {
+        cerr << "[TRACE] cannot size " << shm_name << endl;
+        assert(0);
+    }
+    uint8_t *map = (uint8_t *)mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cerr << "[TRACE] cannot map " << shm_name << endl;
+        assert(0);
+    }
+    header = (TRACE_SERVER_HEADER *)map;
+    slots = map + trace_server_header_size();
+
+    memset((void *)header, 0, sizeof(TRACE_SERVER_HEADER));
+    header->server_pid = getpid();
+
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header->lock, &mutex_attr);
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&header->produced_cond, &cond_attr);
+    pthread_cond_init(&header->consumed_cond, &cond_attr);
+
+    pass_start.push_back(0);
+
+    // readers check the magic last
+    __sync_synchronize();
+    memcpy(header->magic, TRACE_SERVER_MAGIC, sizeof(header->magic));
+}
+
+TRACE_SERVER::~TRACE_SERVER()
+{
+    shm_unlink(shm_name.c_str());
+    munmap(header, map_size);
+    delete source;
+}
+
+// with the lock held: 1 if chunk n may be written, 2 if the pass must start over at n first, 0 to wait
+int TRACE_SERVER::can_write(uint64_t n)
+{
+    uint32_t num_readers = 0;
+    uint64_t oldest = n;
+    for (uint32_t r=0; r<TRACE_SERVER_READERS; r++) {
+        if (header->reader_pid[r] == 0)
+            continue;
+        if (!process_alive(header->reader_pid[r])) {
+            header->reader_pid[r] = 0; // exited without detaching
+            continue;
+        }
+        num_readers++;
+        if (header->reader_chunk[r] < oldest)
+            oldest = header->reader_chunk[r];
+    }
+
+    if (num_readers) {
+        if (n < (oldest + TRACE_SERVER_SLOTS))
+            return 1;
+    }
+    else {
+        // nobody to wait for: keep the oldest pass start for the next reader, or make a new one if it is gone
+        if (n < (header->attach_chunk + TRACE_SERVER_SLOTS))
+            return 1;
+        if (n > (header->attach_chunk + TRACE_SERVER_SLOTS))
+            return 2;
+    }
+
+    return 0;
+}
+
+void TRACE_SERVER::serve(volatile uint8_t *stop)
+{
+    cout << "Serving " << filename << " as " << shm_name << endl;
+
+    for (uint64_t n = 0; ; n++) {
+        lock_server(header);
+        int action = 0;
+        while ((*stop == 0) && (action == 0)) {
+            action = can_write(n);
+            if (action == 0)
+                wait_server(&header->consumed_cond, header);
+        }
+        if (*stop) {
+            pthread_mutex_unlock(&header->lock);
+            break;
+        }
+
+        if (action == 2) {
+            pass_start.clear();
+            pass_start.push_back(n);
+            header->attach_chunk = n;
+        }
+        else if ((n >= TRACE_SERVER_SLOTS) && pass_start.size() && (pass_start.front() == (n - TRACE_SERVER_SLOTS))) {
+            // overwriting a pass start, readers that attach from now on begin at the next one (or wait for it)
+            pass_start.pop_front();
+            header->attach_chunk = pass_start.size() ? pass_start.front() : (n - TRACE_SERVER_SLOTS);
+        }
+        pthread_mutex_unlock(&header->lock);
+
+        if (action == 2)
+            source->restart();
+
+        uint64_t size = source->read(slots + (n % TRACE_SERVER_SLOTS) * TRACE_CHUNK_SIZE, 1, TRACE_CHUNK_SIZE);
+
+        lock_server(header);
+        header->chunk_size[n % TRACE_SERVER_SLOTS] = size;
+        header->produced = n + 1;
+        if (size == 0) {
+            pass_start.push_back(n + 1);
+            if (pass_start.size() == 1)
+                header->attach_chunk = n + 1;
+        }
+        pthread_cond_broadcast(&header->produced_cond);
+        pthread_mutex_unlock(&header->lock);
+
+        if (size == 0)
+            source->restart();
+    }
+}
+
+SERVED_TRACE_READER *SERVED_TRACE_READER::attach(string filename)
+{
+    string shm_name = trace_server_name(filename);
+    int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        return NULL;
+
+    uint64_t header_size = trace_server_header_size(),
+             slots_size = (uint64_t)TRACE_SERVER_SLOTS * TRACE_CHUNK_SIZE;
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) || ((uint64_t)shm_stat.st_size != (header_size + slots_size))) {
+        close(fd);
+        return NULL;
+    }
+
+    // only the header is writable, the chunks are read in place
+    TRACE_SERVER_HEADER *header = (TRACE_SERVER_HEADER *)mmap(NULL, header_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const uint8_t *slots = (const uint8_t *)mmap(NULL, slots_size, PROT_READ, MAP_SHARED, fd, header_size);
+    close(fd);
+    if ((header == MAP_FAILED) || (slots == MAP_FAILED) || memcmp(header->magic, TRACE_SERVER_MAGIC, sizeof(header->magic))
+        || !process_alive(header->server_pid)) {
+        if (header != MAP_FAILED)
+            munmap(header, header_size);
+        if (slots != MAP_FAILED)
+            munmap((void *)slots, slots_size);
+        return NULL;
+    }
+
+    SERVED_TRACE_READER *served = new SERVED_TRACE_READER();
+    served->filename = filename;
+    served->record_size = 0;
+    served->header = header;
+    served->slots = slots;
+    served->map_size = header_size;
+    served->current = NULL;
+    served->current_size = 0;
+    served->current_pos = 0;
+    served->loaded = 0;
+    served->at_end = 0;
+
+    lock_server(header);
+    served->reader = TRACE_SERVER_READERS;
+    for (uint32_t r=0; r<TRACE_SERVER_READERS; r++) {
+        if ((header->reader_pid[r] == 0) || !process_alive(header->reader_pid[r])) {
+            served->reader = r;
+            break;
+        }
+    }
+    if (served->reader == TRACE_SERVER_READERS) {
+        cerr << "[TRACE] the server for " << filename << " has " << TRACE_SERVER_READERS << " readers already" << endl;
+        assert(0);
+    }
+
+    // begin at the oldest pass start if the server still has it, otherwise at the start of the next pass
+    served->seeking = ((header->attach_chunk + TRACE_SERVER_SLOTS) <= header->produced);
+    served->chunk = served->seeking ? header->produced : header->attach_chunk;
+    header->reader_pid[served->reader] = getpid();
+    header->reader_chunk[served->reader] = served->chunk;
+    pthread_mutex_unlock(&header->lock);
+
+    return served;
+}
+
+SERVED_TRACE_READER::~SERVED_TRACE_READER()
+{
+    lock_server(header);
+    header->reader_pid[reader] = 0;
+    pthread_cond_broadcast(&header->consumed_cond);
+    pthread_mutex_unlock(&header->lock);
+
+    munmap(header, map_size);
+    munmap((void *)slots, (uint64_t)TRACE_SERVER_SLOTS * TRACE_CHUNK_SIZE);
+}
+
+// lets go of the chunk being read and moves to the next one, returns 0 at the end of the pass
+int SERVED_TRACE_READER::advance()
+{
+    lock_server(header);
+    if (loaded) {
+        chunk++;
+        loaded = 0;
+    }
+
+    while (1) {
+        header->reader_chunk[reader] = chunk;
+        pthread_cond_broadcast(&header->consumed_cond);
+
+        while (chunk >= header->produced) {
+            wait_server(&header->produced_cond, header);
+            if ((chunk >= header->produced) && !process_alive(header->server_pid)) {
+                cerr << "[TRACE] the trace server for " << filename << " exited" << endl;
+                assert(0);
+            }
+        }
+
+        current_size = header->chunk_size[chunk % TRACE_SERVER_SLOTS];
+        if (seeking || (current_size == 0)) {
+            if (current_size == 0) {
+                if (seeking == 0) {
+                    at_end = 1; // stays on the empty chunk, restart() moves past it
+                    break;
+                }
+                seeking = 0;
+            }
+            chunk++;
+            continue;
+        }
+
+        current = slots + (chunk % TRACE_SERVER_SLOTS) * TRACE_CHUNK_SIZE;
+        loaded = 1;
+        break;
+    }
+    pthread_mutex_unlock(&header->lock);
+
+    current_pos = 0;
+    return loaded;
+}
+
+size_t SERVED_TRACE_READER::read(void *data, size_t size, size_t count)
+{
+    uint8_t *out = (uint8_t *)data;
+    size_t num_bytes = size * count, copied = 0;
+
+    while (copied < num_bytes) {
+        if ((current_pos == current_size) && (at_end || (advance() == 0)))
+            break;
+
+        size_t n = current_size - current_pos;
+        if (n > (num_bytes - copied))
+            n = num_bytes - copied;
+        memcpy(out + copied, current + current_pos, n);
+        current_pos += n;
+        copied += n;
+    }
+
+    return copied / size;
+}
+
+uint64_t SERVED_TRACE_READER::skip(uint64_t num_bytes)
+{
+    uint64_t skipped = 0;
+
+    while (skipped < num_bytes) {
+        if ((current_pos == current_size) && (at_end || (advance() == 0)))
+            break;
+
+        uint64_t n = current_size - current_pos;
+        if (n > (num_bytes - skipped))
+            n = num_bytes - skipped;
+        current_pos += n;
+        skipped += n;
+    }
+
+    return skipped;
+}
+
+// the next pass starts right after the end of this one; from the middle of a pass, read through to it
+void SERVED_TRACE_READER::restart()
+{
+    lock_server(header);
+    if (at_end)
+        chunk++;
+    else if (loaded) {
+        chunk++;
+        seeking = 1;
+    }
+    at_end = 0;
+    loaded = 0;
+    current_size = 0;
+    current_pos = 0;
+    header->reader_chunk[reader] = chunk;
+    pthread_cond_broadcast(&header->consumed_cond);
+    pthread_mutex_unlock(&header->lock);
+}
+
+static_assert((NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES) <= 6, "register and address bits do not fit the operand and memory columns");
+
+static inline void put_varint(vector <uint8_t> &column, int64_t value)
+{
+    uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); // zigzag, small negative deltas stay short
+    while (v >= 0x80) {
+        column.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    column.push_back(v);
+}
+
+static inline int64_t get_varint(const uint8_t *&pos)
+{
+    uint64_t v = 0;
+    for (uint32_t shift = 0; ; shift += 7) {
+        uint8_t byte = *pos++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            break;
+    }
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static inline uint32_t ip_table_index(uint64_t ip)
+{
+    return (ip ^ (ip >> 10) ^ (ip >> 20)) & (TRACE_COLUMN_IP_TABLE - 1);
+}
+
+void encode_columns(const input_instr *records, uint64_t num_records, vector <uint8_t> &out)
+{
+    vector <uint8_t> column[NUM_TRACE_COLUMNS];
+    vector <uint64_t> last_address(TRACE_COLUMN_IP_TABLE * (NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES));
+    uint64_t ip = 0;
+
+    for (uint64_t i=0; i<num_records; i++) {
+        const input_instr &instr = records[i];
+        uint8_t operands = instr.is_branch | (instr.branch_taken << 1), memory = 0;
+
+        for (uint32_t j=0; j<NUM_INSTR_DESTINATIONS; j++) {
+            if (instr.destination_registers[j]) {
+                operands |= 1 << (2 + j);
+                column[2].push_back(instr.destination_registers[j]);
+            }
+        }
+        for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+            if (instr.source_registers[j]) {
+                operands |= 1 << (2 + NUM_INSTR_DESTINATIONS + j);
+                column[2].push_back(instr.source_registers[j]);
+            }
+        }
+
+        put_varint(column[3], instr.ip - ip);
+        ip = instr.ip;
+
+        uint64_t *last = &last_address[ip_table_index(ip) * (NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES)];
+        for (uint32_t j=0; j<(NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES); j++) {
+            uint64_t address = (j < NUM_INSTR_DESTINATIONS) ? instr.destination_memory[j] : instr.source_memory[j - NUM_INSTR_DESTINATIONS];
+            if (address) {
+                memory |= 1 << j;
+                put_varint(column[4], address - last[j]);
+                last[j] = address;
+            }
+        }
+
+        column[0].push_back(operands);
+        column[1].push_back(memory);
+    }
+
+    out.clear();
+    for (uint32_t c=0; c<NUM_TRACE_COLUMNS; c++) {
+        uint32_t size = column[c].size();
+        out.insert(out.end(), (uint8_t *)&size, (uint8_t *)&size + sizeof(size));
+    }
+    for (uint32_t c=0; c<NUM_TRACE_COLUMNS; c++)
+        out.insert(out.end(), column[c].begin(), column[c].end());
+}
+
+int decode_columns(const uint32_t *column_size, const uint8_t *columns, input_instr *records, uint64_t num_records)
+{
+    if ((column_size[0] != num_records) || (column_size[1] != num_records))
+        return 0;
+
+    const uint8_t *operands = columns,
+                  *memory = operands + column_size[0],
+                  *registers_end = memory + column_size[1] + column_size[2],
+                  *ips_end = registers_end + column_size[3],
+                  *addresses_end = ips_end + column_size[4];
+    const uint8_t *registers = memory + column_size[1], *ips = registers_end, *addresses = ips_end;
+    vector <uint64_t> last_address(TRACE_COLUMN_IP_TABLE * (NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES));
+    uint64_t ip = 0;
+
+    // the fixed-width columns fill the whole batch first, only the varint columns are walked record by record
+    memset((void *)records, 0, num_records * sizeof(input_instr));
+    for (uint64_t i=0; i<num_records; i++) {
+        records[i].is_branch = operands[i] & 1;
+        records[i].branch_taken = (operands[i] >> 1) & 1;
+    }
+
+    for (uint64_t i=0; i<num_records; i++) {
+        input_instr &instr = records[i];
+
+        for (uint32_t j=0; j<NUM_INSTR_DESTINATIONS; j++)
+            if (operands[i] & (1 << (2 + j)))
+                instr.destination_registers[j] = *registers++;
+        for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++)
+            if (operands[i] & (1 << (2 + NUM_INSTR_DESTINATIONS + j)))
+                instr.source_registers[j] = *registers++;
+
+        ip += get_varint(ips);
+        instr.ip = ip;
+
+        uint64_t *last = &last_address[ip_table_index(ip) * (NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES)];
+        for (uint32_t j=0; j<(NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES); j++) {
+            if (memory[i] & (1 << j)) {
+                last[j] += get_varint(addresses);
+                if (j < NUM_INSTR_DESTINATIONS)
+                    instr.destination_memory[j] = last[j];
+                else
+                    instr.source_memory[j - NUM_INSTR_DESTINATIONS] = last[j];
+            }
+        }
+
+        if ((registers > registers_end) || (ips > ips_end) || (addresses > addresses_end))
+            return 0;
+    }
+
+    return (registers == registers_end) && (ips == ips_end) && (addresses == addresses_end);
+}
+
+BLOCK_TRACE_READER::BLOCK_TRACE_READER(string name)
+{
+    filename = name;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if ((fd < 0) || fstat(fd, &file_stat)) {
+        cerr << "[TRACE] cannot open " << filename << endl;
+        assert(0);
+    }
+    map_size = file_stat.st_size;
+
+    map = (map_size >= sizeof(BLOCK_TRACE_HEADER)) ? (uint8_t *)mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0) : (uint8_t *)MAP_FAILED;
+    close(fd);
+
+    header = (const BLOCK_TRACE_HEADER *)map;
+    if ((map == MAP_FAILED) || memcmp(header->magic, BLOCK_TRACE_MAGIC, sizeof(header->magic)) || (header->version != BLOCK_TRACE_VERSION)
+        || (header->record_size == 0) || (header->records_per_block == 0)
+        || ((header->encoding == BLOCK_TRACE_COLUMNAR) && (header->record_size != sizeof(input_instr)))
+        || (header->index_offset + header->num_blocks*sizeof(BLOCK_TRACE_INDEX) > map_size)) {
+        cerr << "[TRACE] " << filename << " is not a version " << BLOCK_TRACE_VERSION << " block trace" << endl;
+        assert(0);
+    }
+
+    index = (const BLOCK_TRACE_INDEX *)(map + header->index_offset);
+    record_size = header->record_size;
+    block_bytes = header->records_per_block * record_size;
+    total_bytes = header->num_records * record_size;
+
+    load_block(0);
+}
+
+BLOCK_TRACE_READER::~BLOCK_TRACE_READER()
+{
+    munmap(map, map_size);
+}
+
+// the block past the last one is empty, that is the end of the trace
+void BLOCK_TRACE_READER::load_block(uint64_t b)
+{
+    block = b;
+    block_pos = 0;
+    block_data = NULL;
+    block_size = 0;
+    if (b >= header->num_blocks)
+        return;
+
+    block_size = ((b + 1) < header->num_blocks) ? block_bytes : (total_bytes - b*block_bytes);
+    const uint8_t *data = map + index[b].offset;
+    uint64_t size = index[b].size;
+
+    // columnar blocks keep their column sizes in front, uncompressed
+    uint32_t column_size[NUM_TRACE_COLUMNS];
+    uint64_t raw_size = block_size;
+    if (header->encoding == BLOCK_TRACE_COLUMNAR) {
+        memcpy(column_size, data, sizeof(column_size));
+        data += sizeof(column_size);
+        size -= sizeof(column_size);
+        raw_size = 0;
+        for (uint32_t c=0; c<NUM_TRACE_COLUMNS; c++)
+            raw_size += column_size[c];
+    }
+
+    if (header->compression == BLOCK_TRACE_ZLIB) {
+        uLongf inflated_size = raw_size;
+        inflated.resize(raw_size);
+        if ((uncompress(inflated.data(), &inflated_size, data, size) != Z_OK) || (inflated_size != raw_size)) {
+            cerr << "[TRACE] " << filename << " block " << b << " is corrupt" << endl;
+            assert(0);
+        }
+        data = inflated.data();
+    }
+
+    if (header->encoding == BLOCK_TRACE_COLUMNAR) {
+        decoded.resize(block_size);
+        if (decode_columns(column_size, data, (input_instr *)decoded.data(), block_size / sizeof(input_instr)) == 0) {
+            cerr << "[TRACE] " << filename << " block " << b << " has corrupt columns" << endl;
+            assert(0);
+        }
+        data = decoded.data();
+    }
+
+    block_data = data;
+}
+
+size_t BLOCK_TRACE_READER::read(void *data, size_t size, size_t count)
+{
+    uint8_t *out = (uint8_t *)data;
+    size_t num_bytes = size * count, copied = 0;
+
+    while (copied < num_bytes) {
+        if (block_pos == block_size) {
+            if (block >= header->num_blocks)
+                break;
+            load_block(block + 1);
+            continue;
+        }
+
+        size_t n = block_size - block_pos;
+        if (n > (num_bytes - copied))
+            n = num_bytes - copied;
+        memcpy(out + copied, block_data + block_pos, n);
+        block_pos += n;
+        copied += n;
+    }
+
+    return copied / size;
+}
+
+uint64_t BLOCK_TRACE_READER::skip(uint64_t num_bytes)
+{
+    uint64_t position = (block < header->num_blocks) ? (block*block_bytes + block_pos) : total_bytes,
+             target = position + num_bytes;
+    if (target > total_bytes)
+        target = total_bytes;
+
+    // decode only the block the skip ends in
+    if ((target / block_bytes) != block)
+        load_block(target / block_bytes);
+    block_pos = target - block*block_bytes;
+
+    return target - position;
+}
+
+void BLOCK_TRACE_READER::restart()
+{
+    load_block(0);
+}
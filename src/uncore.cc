@@ -7,3 +7,139 @@ UNCORE uncore;
 UNCORE::UNCORE() {
 
 }
+
+// called between quanta: each core then sees the requests the other cores still have queued
+void UNCORE::update_port_view()
+{
+    uint32_t total_pending[4] = {0, 0, 0, 0};
+
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        for (uint32_t j=0; j<4; j++)
+            total_pending[j] += port[i].num_pending[j];
+
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        for (uint32_t j=0; j<4; j++)
+            port[i].num_other_pending[j] = total_pending[j] - port[i].num_pending[j];
+}
+
+int LLC_PORT::add_request(uint8_t queue_type, PACKET *packet)
+{
+    PORT_REQUEST new_request;
+    new_request.queue_type = queue_type;
+    new_request.cycle = current_core_cycle[cpu];
+    new_request.packet = *packet;
+
+    request.push_back(new_request);
+    num_pending[queue_type]++;
+
+    return -1;
+}
+
+int LLC_PORT::add_rq(PACKET *packet)
+{
+    return add_request(1, packet);
+}
+
+int LLC_PORT::add_wq(PACKET *packet)
+{
+    return add_request(2, packet);
+}
+
+int LLC_PORT::add_pq(PACKET *packet)
+{
+    return add_request(3, packet);
+}
+
+void LLC_PORT::add_walk(PACKET *packet)
+{
+    PORT_REQUEST new_walk;
+    new_walk.queue_type = 0;
+    new_walk.cycle = current_core_cycle[cpu];
+    new_walk.packet = *packet;
+
+    walk.push_back(new_walk);
+
+    // stall the core right away, as va_to_pa() would; a swap extends the stall once the walk is resolved
+    stall_cycle[cpu] = current_core_cycle[cpu] + PAGE_TABLE_LATENCY;
+}
+
+void LLC_PORT::return_data(PACKET *packet)
+{
+    // the LLC returns data directly to the L2C
+    assert(0);
+}
+
+void LLC_PORT::operate()
+{
+
+}
+
+void LLC_PORT::increment_WQ_FULL(uint64_t address)
+{
+    WQ_FULL++;
+}
+
+void LLC_PORT::warm_access(PACKET *packet)
+{
+    // functional warmup runs before the core threads start, so it can go straight to the LLC
+    lower_level->warm_access(packet);
+}
+
+uint32_t LLC_PORT::get_occupancy(uint8_t queue_type, uint64_t address)
+{
+    uint32_t occupancy = lower_level->get_occupancy(queue_type, address),
+             size = lower_level->get_size(queue_type, address);
+
+    if ((queue_type == 0) || (queue_type > 3))
+        return occupancy;
+
+    // the core sees the LLC as it was at the start of the quantum plus the requests still waiting in the ports
+    occupancy += num_pending[queue_type] + num_other_pending[queue_type];
+    if (occupancy > size)
+        occupancy = size;
+
+    return occupancy;
+}
+
+uint32_t LLC_PORT::get_size(uint8_t queue_type, uint64_t address)
+{
+    return lower_level->get_size(queue_type, address);
+}
+
+void LLC_PORT::drain(uint64_t cycle)
+{
+    // page walks, resolved against the shared page table at the cycle the core issued them
+    while (walk.size() && (walk.front().cycle <= cycle)) {
+        PACKET *packet = &walk.front().packet;
+
+        uint64_t pa = va_to_pa(cpu, packet->instr_id, packet->full_addr, packet->address);
+
+        packet->data = pa >> LOG2_PAGE_SIZE;
+        packet->event_cycle = cycle;
+        stlb->return_data(packet);
+
+        walk.pop_front();
+    }
+
+    // LLC requests, in the order the L2C issued them
+    // a request that does not fit stays here (together with everything behind it) until the next cycle
+    while (request.size() && (request.front().cycle <= cycle)) {
+        PORT_REQUEST *front = &request.front();
+
+        if (lower_level->get_occupancy(front->queue_type, front->packet.address) >= lower_level->get_size(front->queue_type, front->packet.address))
+            break;
+
+        if (front->queue_type == 1)
+            lower_level->add_rq(&front->packet);
+        else if (front->queue_type == 2)
+            lower_level->add_wq(&front->packet);
+        else
+            lower_level->add_pq(&front->packet);
+
+        num_pending[front->queue_type]--;
+        request.pop_front();
+    }
+
+    for (; WQ_FULL; WQ_FULL--)
+        lower_level->increment_WQ_FULL(0);
+}